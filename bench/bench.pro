@@ -0,0 +1,26 @@
+#-------------------------------------------------
+#
+# Medidas por etapa y de extremo a extremo (sin interfaz)
+#
+#-------------------------------------------------
+
+QT -= core gui
+
+TARGET = bench
+TEMPLATE = app
+
+CONFIG += console c++11 thread
+CONFIG -= qt app_bundle
+
+SOURCES += main.cpp
+
+#Imagenes de referencia incluidas en el repositorio
+DEFINES += BENCH_IMAGENES=\\\"$$PWD/imagenes\\\"
+
+INCLUDEPATH += /usr/local/include/opencv4
+INCLUDEPATH += $$PWD/../segmentacion
+
+LIBS += -L$$OUT_PWD/../segmentacion -lsegmentacion
+PRE_TARGETDEPS += $$OUT_PWD/../segmentacion/libsegmentacion.a
+
+LIBS += -L/usr/local/lib -lopencv_imgproc -lopencv_core -lopencv_imgcodecs
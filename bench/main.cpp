@@ -0,0 +1,489 @@
+#include <segmentador.h>
+
+#include <opencv2/imgcodecs/imgcodecs.hpp>
+#include <opencv2/core/utils/allocator_stats.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ * Medidas de cada etapa por separado y del pipeline completo sobre las imagenes de
+ * referencia, en grises y color, rango fijo y flotante, varios max_box y resoluciones.
+ * Para cada medida se da la mediana, el percentil 99 y los megapixeles por segundo.
+ * No necesita interfaz grafica: la etapa "visor" reproduce la conversion que hace
+ * ImgViewer::paintEvent en modo con copia (en modo sin copia no hay conversion).
+ * Con -p no mide: comprueba que el etiquetado unionfind por franjas da el mismo resultado que
+ * el serie y sale con 2 si alguna configuracion difiere.
+ * Con -a tampoco mide: tras una vuelta de calentamiento por una secuencia de frames distintos,
+ * segmenta -n frames mas de la secuencia, cuenta las reservas reales de memoria (operator new del
+ * proceso y cv::Mat) y sale con 2 si en alguna configuracion los buffers del Segmentador vuelven
+ * a reservar.
+ */
+
+//Todas las reservas con operator new del proceso (contenedores, std::function, buffers internos
+//de OpenCV), para bench -a; new[] y la version nothrow acaban aqui
+static std::atomic<uint64_t> llamadasNew(0);
+
+void *operator new(size_t n)
+{
+    llamadasNew.fetch_add(1, std::memory_order_relaxed);
+    void *p = malloc(n ? n : 1);
+    if (p == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+
+//Sin inline: si GCC ve el free() en el llamador lo toma por un delete mal emparejado
+#if defined(__GNUC__)
+__attribute__((noinline))
+#endif
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+#ifndef BENCH_IMAGENES
+#define BENCH_IMAGENES "imagenes"
+#endif
+
+static void uso(const char *prog)
+{
+    fprintf(stderr, "Uso: %s [opciones]\n"
+                    "  -d <dir>      imagenes de referencia (por defecto %s)\n"
+                    "  -n <n>        repeticiones por medida (por defecto 20)\n"
+                    "  -r <WxH,...>  resoluciones (por defecto 320x240,640x480,1280x720)\n"
+                    "  -m <n,...>    valores de max_box (por defecto 2,5,10)\n"
+                    "  -e <m>        motor de etiquetado: floodfill (defecto), unionfind, crecimiento\n"
+                    "  -32           etiquetas siempre de 32 bits (por defecto 16 mientras quepan)\n"
+                    "  -g            blur fusionado con las derivadas de Canny\n"
+                    "  -p            comprueba que unionfind por franjas coincide con el serie (sin medir)\n"
+                    "  -a            cuenta las reservas de memoria por frame tras calentar (sin medir)\n"
+                    "  -csv          salida en CSV\n", prog, BENCH_IMAGENES);
+}
+
+static bool motorPorNombre(const char *nombre, Segmentador::Motor &motor)
+{
+    if (!strcmp(nombre, "floodfill"))
+        motor = Segmentador::MOTOR_FLOODFILL;
+    else if (!strcmp(nombre, "unionfind"))
+        motor = Segmentador::MOTOR_UNIONFIND;
+    else if (!strcmp(nombre, "crecimiento"))
+        motor = Segmentador::MOTOR_CRECIMIENTO;
+    else
+        return false;
+    return true;
+}
+
+static bool leerResoluciones(const char *lista, std::vector<Size> &resoluciones)
+{
+    resoluciones.clear();
+    for (const char *p = lista; *p; )
+    {
+        int w, h, n = 0;
+        if (sscanf(p, "%dx%d%n", &w, &h, &n) != 2 || w <= 0 || h <= 0)
+            return false;
+        resoluciones.push_back(Size(w, h));
+        p += n;
+        if (*p == ',')
+            p++;
+    }
+    return !resoluciones.empty();
+}
+
+static bool leerEnteros(const char *lista, std::vector<int> &valores)
+{
+    valores.clear();
+    for (const char *p = lista; *p; )
+    {
+        int v, n = 0;
+        if (sscanf(p, "%d%n", &v, &n) != 1)
+            return false;
+        valores.push_back(v);
+        p += n;
+        if (*p == ',')
+            p++;
+    }
+    return !valores.empty();
+}
+
+static std::string nombreFichero(const std::string &ruta)
+{
+    size_t pos = ruta.find_last_of("/\\");
+    return pos == std::string::npos ? ruta : ruta.substr(pos + 1);
+}
+
+static double ahoraMs()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//Mediana y percentil 99 de una serie de tiempos (la ordena)
+static void estadisticas(std::vector<double> &tiempos, double &mediana, double &p99)
+{
+    std::sort(tiempos.begin(), tiempos.end());
+    size_t n = tiempos.size();
+    mediana = n % 2 ? tiempos[n / 2] : 0.5 * (tiempos[n / 2 - 1] + tiempos[n / 2]);
+    size_t i = (size_t)(0.99 * n + 0.999999);
+    p99 = tiempos[std::min(n, std::max<size_t>(i, 1)) - 1];
+}
+
+//Mismas etiquetas, tabla de regiones y destino
+static bool mismoResultado(const Segmentador &a, const Segmentador &b, const Mat &destA, const Mat &destB)
+{
+    const Mat &ea = a.getImgRegiones(), &eb = b.getImgRegiones();
+    if (ea.size() != eb.size() || ea.type() != eb.type() || destA.size() != destB.size() || destA.type() != destB.type())
+        return false;
+    for (int y = 0; y < ea.rows; y++)
+        if (memcmp(ea.ptr(y), eb.ptr(y), ea.cols * ea.elemSize()) != 0
+                || memcmp(destA.ptr(y), destB.ptr(y), destA.cols * destA.elemSize()) != 0)
+            return false;
+    const TablaRegiones &ra = a.getListRegiones(), &rb = b.getListRegiones();
+    return ra.nPuntos == rb.nPuntos && ra.pIni == rb.pIni && ra.gMedio == rb.gMedio && ra.rgbMedio == rb.rgbMedio
+            && ra.caja == rb.caja && ra.suma == rb.suma && ra.sumaCuadrados == rb.sumaCuadrados;
+}
+
+/** Segmenta con unionfind en serie y por franjas en cada imagen, resolucion, gris/color,
+ * conectividad y max_box en rango flotante (el unico que usa franjas), y compara los resultados
+ * @brief comprobarFranjas
+ * @return configuraciones en las que alguna particion en franjas difiere del serie
+ */
+static int comprobarFranjas(const std::vector<Mat> &imagenes, const std::vector<std::string> &nombres,
+                            const std::vector<Size> &resoluciones, const std::vector<int> &maxBoxes, bool etiquetas16)
+{
+    static const int nFranjas[] = { 2, 3, 4, 7, 16 };
+    Mat colorImage, grayImage, destColor, destGray, destColorFranjas, destGrayFranjas;
+    int casos = 0, distintos = 0;
+
+    for (size_t im = 0; im < imagenes.size(); im++)
+    for (size_t r = 0; r < resoluciones.size(); r++)
+    {
+        cv::resize(imagenes[im], colorImage, resoluciones[r]);
+        cvtColor(colorImage, grayImage, COLOR_RGB2GRAY);
+
+        for (int color = 0; color < 2; color++)
+        for (int conectividad = 4; conectividad <= 8; conectividad += 4)
+        for (size_t m = 0; m < maxBoxes.size(); m++)
+        {
+            Segmentador::Parametros param;
+            param.maxBox = maxBoxes[m];
+            param.color = color;
+            param.rangoFlotante = true;
+            param.conectividad = conectividad;
+            param.motor = Segmentador::MOTOR_UNIONFIND;
+            param.etiquetas16 = etiquetas16;
+            Segmentador serie;
+            serie.setParametros(param);
+            serie.segmentation(colorImage, grayImage, destColor, destGray);
+
+            bool igual = true;
+            for (size_t f = 0; f < sizeof(nFranjas) / sizeof(nFranjas[0]); f++)
+            {
+                param.franjas = nFranjas[f];
+                Segmentador franjas;
+                franjas.setParametros(param);
+                franjas.segmentation(colorImage, grayImage, destColorFranjas, destGrayFranjas);
+                if (!mismoResultado(serie, franjas, color ? destColor : destGray, color ? destColorFranjas : destGrayFranjas))
+                {
+                    printf("DISTINTO %s %dx%d %s %d-vecindad max %d, %d franjas\n", nombres[im].c_str(),
+                           resoluciones[r].width, resoluciones[r].height, color ? "color" : "gris",
+                           conectividad, maxBoxes[m], nFranjas[f]);
+                    igual = false;
+                }
+            }
+            casos++;
+            if (!igual)
+                distintos++;
+        }
+    }
+    printf("Franjas: %d configuraciones, %d distintas del serie\n", casos, distintos);
+    return distintos;
+}
+
+/** Secuencia de frames de una resolucion: cada imagen y tres copias con un cuadrado distinto
+ * aclarado, para que el modo incremental vea cambios pequenos entre copias y grandes entre imagenes
+ * @brief secuenciaFrames
+ */
+static void secuenciaFrames(const std::vector<Mat> &imagenes, Size resolucion, std::vector<Mat> &colores,
+                            std::vector<Mat> &grises)
+{
+    colores.clear();
+    grises.clear();
+    int lado = std::max(8, std::min(resolucion.width, resolucion.height) / 8);
+    for (size_t im = 0; im < imagenes.size(); im++)
+    {
+        Mat base;
+        cv::resize(imagenes[im], base, resolucion);
+        for (int v = 0; v < 4; v++)
+        {
+            Mat color = base.clone();
+            if (v > 0)
+            {
+                Rect cuadrado(v * (resolucion.width - lado) / 4, v * (resolucion.height - lado) / 4, lado, lado);
+                color(cuadrado) += Scalar::all(60);
+            }
+            Mat gray;
+            cvtColor(color, gray, COLOR_RGB2GRAY);
+            colores.push_back(color);
+            grises.push_back(gray);
+        }
+    }
+}
+
+/** En cada resolucion, gris/color, rango, max_box y con y sin modo incremental, segmenta una
+ * vuelta de calentamiento por la secuencia de frames y despues "frames" mas de la secuencia.
+ * Cuenta las reservas reales (operator new y cv::Mat) y las del contador del Segmentador, que
+ * no debe moverse: las que quedan son internas de OpenCV (floodFill, Canny, blur)
+ * @brief comprobarReservas
+ * @return configuraciones en las que los buffers del Segmentador han vuelto a reservar
+ */
+static int comprobarReservas(const std::vector<Mat> &imagenes, const std::vector<Size> &resoluciones,
+                             const std::vector<int> &maxBoxes, const Segmentador::Parametros &base, int frames)
+{
+    cv::utils::AllocatorStatisticsInterface &estadisticasMat = cv::getAllocatorStatistics();
+    std::vector<Mat> colores, grises;
+    Mat destColor, destGray;
+    int casos = 0, conReservas = 0;
+
+    printf("%11s %-5s %-8s %3s %3s %10s %10s %10s\n", "resolucion", "modo", "rango", "max", "inc",
+           "reservas", "new/frame", "Mat/frame");
+    for (size_t r = 0; r < resoluciones.size(); r++)
+    {
+        secuenciaFrames(imagenes, resoluciones[r], colores, grises);
+        int n = (int)colores.size();
+
+        for (int color = 0; color < 2; color++)
+        for (int flotante = 0; flotante < 2; flotante++)
+        for (size_t m = 0; m < maxBoxes.size(); m++)
+        for (int incremental = 0; incremental < 2; incremental++)
+        {
+            Segmentador::Parametros param = base;
+            param.maxBox = maxBoxes[m];
+            param.color = color;
+            param.rangoFlotante = flotante;
+            param.incremental = incremental;
+            Segmentador segmentador;
+            segmentador.setParametros(param);
+
+            for (int k = 0; k < n; k++)
+                segmentador.segmentation(colores[k], grises[k], destColor, destGray);
+            segmentador.resetReservas();
+            uint64_t new0 = llamadasNew.load();
+            uint64_t mat0 = estadisticasMat.getNumberOfAllocations();
+            for (int k = 0; k < frames; k++)
+                segmentador.segmentation(colores[k % n], grises[k % n], destColor, destGray);
+            double newPorFrame = (double)(llamadasNew.load() - new0) / frames;
+            double matPorFrame = (double)(estadisticasMat.getNumberOfAllocations() - mat0) / frames;
+
+            casos++;
+            unsigned long long reservas = (unsigned long long)segmentador.getReservas();
+            if (reservas != 0)
+                conReservas++;
+            printf("%5dx%-5d %-5s %-8s %3d %3s %10llu %10.1f %10.1f%s\n", resoluciones[r].width, resoluciones[r].height,
+                   color ? "color" : "gris", flotante ? "flotante" : "fijo", maxBoxes[m], incremental ? "si" : "no",
+                   reservas, newPorFrame, matPorFrame, reservas != 0 ? "  RESERVAS" : "");
+            fflush(stdout);
+        }
+    }
+    printf("Reservas: %d configuraciones, %d reservan buffers del Segmentador tras calentar\n", casos, conReservas);
+    return conReservas;
+}
+
+struct Config{
+    std::string imagen;
+    Size resolucion;
+    bool color;
+    bool flotante;
+    int maxBox;
+};
+
+static void imprimir(const Config &c, const char *etapa, std::vector<double> &tiempos, int regiones, bool csv)
+{
+    double mediana, p99;
+    estadisticas(tiempos, mediana, p99);
+    double mpx = mediana > 0 ? c.resolucion.area() / (mediana * 1e3) : 0;
+    if (csv)
+        printf("%s,%dx%d,%s,%s,%d,%s,%.4f,%.4f,%.2f,%d\n", c.imagen.c_str(), c.resolucion.width, c.resolucion.height,
+               c.color ? "color" : "gris", c.flotante ? "flotante" : "fijo", c.maxBox, etapa, mediana, p99, mpx, regiones);
+    else
+        printf("%-12s %5dx%-5d %-5s %-8s %3d  %-14s %10.3f %10.3f %10.2f %8d\n", c.imagen.c_str(), c.resolucion.width,
+               c.resolucion.height, c.color ? "color" : "gris", c.flotante ? "flotante" : "fijo", c.maxBox, etapa,
+               mediana, p99, mpx, regiones);
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+    std::string dir = BENCH_IMAGENES;
+    int repeticiones = 20;
+    std::vector<Size> resoluciones;
+    resoluciones.push_back(Size(320, 240));
+    resoluciones.push_back(Size(640, 480));
+    resoluciones.push_back(Size(1280, 720));
+    std::vector<int> maxBoxes;
+    maxBoxes.push_back(2);
+    maxBoxes.push_back(5);
+    maxBoxes.push_back(10);
+    Segmentador::Motor motor = Segmentador::MOTOR_FLOODFILL;
+    bool csv = false;
+    bool etiquetas16 = true;
+    bool fusionado = false;
+    bool franjas = false;
+    bool reservas = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-d") && i + 1 < argc)
+            dir = argv[++i];
+        else if (!strcmp(argv[i], "-n") && i + 1 < argc && (repeticiones = atoi(argv[i + 1])) > 0)
+            i++;
+        else if (!strcmp(argv[i], "-r") && i + 1 < argc && leerResoluciones(argv[i + 1], resoluciones))
+            i++;
+        else if (!strcmp(argv[i], "-m") && i + 1 < argc && leerEnteros(argv[i + 1], maxBoxes))
+            i++;
+        else if (!strcmp(argv[i], "-e") && i + 1 < argc && motorPorNombre(argv[i + 1], motor))
+            i++;
+        else if (!strcmp(argv[i], "-32"))
+            etiquetas16 = false;
+        else if (!strcmp(argv[i], "-g"))
+            fusionado = true;
+        else if (!strcmp(argv[i], "-p"))
+            franjas = true;
+        else if (!strcmp(argv[i], "-a"))
+            reservas = true;
+        else if (!strcmp(argv[i], "-csv"))
+            csv = true;
+        else
+        {
+            uso(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<String> ficheros;
+    cv::glob(dir + "/*", ficheros, false);
+    std::vector<Mat> imagenes;
+    std::vector<std::string> nombres;
+    for (size_t i = 0; i < ficheros.size(); i++)
+    {
+        Mat image = cv::imread(ficheros[i]);
+        if (image.empty())
+            continue;
+        cvtColor(image, image, COLOR_BGR2RGB);
+        imagenes.push_back(image);
+        nombres.push_back(nombreFichero(ficheros[i]));
+    }
+    if (imagenes.empty())
+    {
+        fprintf(stderr, "No hay imagenes en %s\n", dir.c_str());
+        return 1;
+    }
+
+    if (franjas)
+        return comprobarFranjas(imagenes, nombres, resoluciones, maxBoxes, etiquetas16) > 0 ? 2 : 0;
+    if (reservas)
+    {
+        Segmentador::Parametros param;
+        param.motor = motor;
+        param.etiquetas16 = etiquetas16;
+        param.suavizadoFusionado = fusionado;
+        return comprobarReservas(imagenes, resoluciones, maxBoxes, param, repeticiones) > 0 ? 2 : 0;
+    }
+
+    static const char *nombresEtapa[Segmentador::NUM_ETAPAS] = {
+        "bordes", "etiquetado", "asignarBordes", "frontera", "bottomUp"
+    };
+
+    if (csv)
+        printf("imagen,resolucion,modo,rango,maxBox,etapa,mediana_ms,p99_ms,mpx_s,regiones\n");
+    else
+        printf("%-12s %11s %-5s %-8s %3s  %-14s %10s %10s %10s %8s\n", "imagen", "resolucion", "modo", "rango",
+               "max", "etapa", "mediana ms", "p99 ms", "Mpx/s", "regiones");
+
+    std::vector<double> tiempos(repeticiones);
+    Mat colorImage, grayImage, destColorImage, destGrayImage, auxImage;
+    std::vector<uchar> qimg;    //Buffer RGB888 como el QImage de ImgViewer
+
+    for (size_t im = 0; im < imagenes.size(); im++)
+    for (size_t r = 0; r < resoluciones.size(); r++)
+    {
+        cv::resize(imagenes[im], colorImage, resoluciones[r]);
+        cvtColor(colorImage, grayImage, COLOR_RGB2GRAY);
+
+        for (int color = 0; color < 2; color++)
+        for (int flotante = 0; flotante < 2; flotante++)
+        for (size_t m = 0; m < maxBoxes.size(); m++)
+        {
+            Config c;
+            c.imagen = nombres[im];
+            c.resolucion = resoluciones[r];
+            c.color = color;
+            c.flotante = flotante;
+            c.maxBox = maxBoxes[m];
+
+            Segmentador segmentador;
+            Segmentador::Parametros param;
+            param.maxBox = c.maxBox;
+            param.color = c.color;
+            param.rangoFlotante = c.flotante;
+            param.motor = motor;
+            param.etiquetas16 = etiquetas16;
+            param.suavizadoFusionado = fusionado;
+            segmentador.setParametros(param);
+
+            //Extremo a extremo (la primera llamada reserva los buffers y no se mide)
+            segmentador.segmentation(colorImage, grayImage, destColorImage, destGrayImage);
+            int regiones = (int)segmentador.getListRegiones().size();
+            for (int k = 0; k < repeticiones; k++)
+            {
+                double t0 = ahoraMs();
+                segmentador.segmentation(colorImage, grayImage, destColorImage, destGrayImage);
+                tiempos[k] = ahoraMs() - t0;
+            }
+            imprimir(c, "completo", tiempos, regiones, csv);
+
+            //Etapas por separado, en el orden del pipeline para que cada una parta de la anterior
+            for (int e = 0; e < Segmentador::NUM_ETAPAS; e++)
+            {
+                Segmentador::Etapa etapa = (Segmentador::Etapa)e;
+                for (int k = 0; k < repeticiones; k++)
+                {
+                    segmentador.prepararEtapa(etapa);
+                    double t0 = ahoraMs();
+                    segmentador.ejecutarEtapa(etapa, destColorImage, destGrayImage);
+                    tiempos[k] = ahoraMs() - t0;
+                }
+                imprimir(c, nombresEtapa[e], tiempos, regiones, csv);
+            }
+
+            //Conversion de ImgViewer::paintEvent con copia: gris -> RGB y copia al QImage
+            const Mat &salida = c.color ? destColorImage : destGrayImage;
+            qimg.resize(salida.total() * 3);
+            for (int k = 0; k < repeticiones; k++)
+            {
+                double t0 = ahoraMs();
+                if (salida.type() == CV_8UC1)
+                {
+                    cvtColor(salida, auxImage, COLOR_GRAY2RGB);
+                    memcpy(qimg.data(), auxImage.data, qimg.size());
+                }
+                else
+                    memcpy(qimg.data(), salida.data, qimg.size());
+                tiempos[k] = ahoraMs() - t0;
+            }
+            imprimir(c, "visor", tiempos, regiones, csv);
+        }
+    }
+
+    return 0;
+}
@@ -3,6 +3,7 @@
  *
  */
 #include "imgviewer.h"
+#include <instrumentacion.h>
 
 ImgViewer::ImgViewer( int _width, int _height, uchar *img, QWidget *parent) : QGLWidget(parent), width(_width), height(_height)
 {
@@ -163,6 +164,8 @@ void ImgViewer::init( )
 		ctable[i] = qRgb ( i,i,i );
 	qimg->setColorTable ( ctable );
 	translating = false;
+	zeroCopy = false;
+	matViewType = -1;
 	effWin = win;
 	QGLFormat f = format();
 	if (f.sampleBuffers())
@@ -191,16 +194,22 @@ void ImgViewer::setImage(Mat *img)
 
     if (!img->empty())
     {
-        if (qimg != NULL)
-            delete qimg;
-
         ocvimg = img;
         width = ocvimg->cols;
         height = ocvimg->rows;
-        qimg = new QImage ( width, height, QImage::Format_RGB888 );
+        //En modo sin copia qimg no se usa; si no, solo se rehace si cambia el tamano
+        if (!zeroCopy && (qimg == NULL || qimg->width() != width || qimg->height() != height
+                          || qimg->format() != QImage::Format_RGB888))
+        {
+            if (qimg != NULL)
+                delete qimg;
+            qimg = new QImage ( width, height, QImage::Format_RGB888 );
+        }
 
         resize (width,height );
         win.setRect ( 0, 0, width, height );
+        //Los dibujos se dan en coordenadas de imagen, asi se escalan con ella
+        effWin = win;
 
     }
 
@@ -209,11 +218,17 @@ void ImgViewer::setImage(Mat *img)
 
 void ImgViewer::paintEvent ( QPaintEvent * )
 {
+	Cronometro cronometro(Instrumentacion::MED_VISOR);
 	QString s;
 	QPainter painter ( this );
 	painter.setRenderHint(QPainter::HighQualityAntialiasing);
 
-    if(!ocvimg->empty())
+    bool paintMatView = zeroCopy && !ocvimg->empty();
+    if(paintMatView)
+    {
+        painter.drawImage ( QRectF(0., 0., imageScale*width, imageScale*height), wrapMat(), QRectF(0, 0, width, height) );
+    }
+    else if(!ocvimg->empty())
     {
         Mat auxImage;
         switch(ocvimg->type())
@@ -230,7 +245,7 @@ void ImgViewer::paintEvent ( QPaintEvent * )
 
     }
 
-    if ( qimg != NULL )
+    if ( qimg != NULL && !paintMatView )
     {
             painter.drawImage ( QRectF(0., 0., imageScale*width, imageScale*height), *qimg, QRectF(0, 0, width, height) );
     }
@@ -329,6 +344,33 @@ void ImgViewer::paintEvent ( QPaintEvent * )
 }
 
 
+/** Devuelve una QImage que envuelve el buffer de ocvimg respetando su stride.
+ * Solo se reconstruye la cabecera cuando cambia el buffer, el tamano o el tipo del Mat.
+ */
+const QImage &ImgViewer::wrapMat()
+{
+	const uchar *data = ocvimg->data;
+	if (matView.constBits() != data || matView.width() != ocvimg->cols || matView.height() != ocvimg->rows
+	        || matView.bytesPerLine() != (int)ocvimg->step || matViewType != ocvimg->type())
+	{
+		matViewType = ocvimg->type();
+		if (matViewType == CV_8UC3)
+			matView = QImage(data, ocvimg->cols, ocvimg->rows, (int)ocvimg->step, QImage::Format_RGB888);
+		else
+		{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 5, 0)
+			matView = QImage(data, ocvimg->cols, ocvimg->rows, (int)ocvimg->step, QImage::Format_Grayscale8);
+#else
+			//Con datos de solo lectura setColorTable forzaria una copia; el buffer nunca se escribe desde aqui
+			matView = QImage(const_cast<uchar *>(data), ocvimg->cols, ocvimg->rows, (int)ocvimg->step, QImage::Format_Indexed8);
+			matView.setColorTable(ctable);
+#endif
+		}
+	}
+	return matView;
+}
+
+
 void ImgViewer::drawSquare ( const QRect &rect, const QColor & col, bool fill, int id, float rot, float width)
 {
 	TRect r;
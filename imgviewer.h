@@ -33,6 +33,7 @@ public:
 	void setImage(QImage *img);
     void setImage(Mat *img);
 	void paintEvent(QPaintEvent *);
+	const QImage &wrapMat();
 	void setWindow(const QRect & win_) { effWin = win = win_; }
 	void drawSquare(const QRect &, const QColor &,  bool fill=false, int id= -1, float rads=0, float width=0);
 	void drawSquare(const QPoint &, int sideX, int sideY, const QColor &,  bool fill=false , int id= -1, float rads=0, float width=0);
@@ -53,6 +54,9 @@ public:
 	uint32_t getHeight() { return height; }
 	void autoResize();
 	uchar *imageBuffer() { if (qimg != NULL) return qimg->bits(); return NULL; }
+	//Pinta directamente desde el buffer del Mat, sin convertir ni copiar
+	void setZeroCopy(bool enable) { zeroCopy = enable; }
+	bool isZeroCopy() const { return zeroCopy; }
 	
 
 protected:
@@ -105,6 +109,9 @@ protected:
 
 	QImage *qimg;
     Mat *ocvimg;
+	bool zeroCopy;
+	QImage matView;	//Cabecera sobre ocvimg->data, se rehace solo si cambia el buffer
+	int matViewType;
 	QVector<QRgb> ctable; //For gray conversion
 	QPoint inicio, actual;
 	bool translating;
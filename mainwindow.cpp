@@ -1,9 +1,13 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include "QMessageBox"
+#include <QApplication>
 #include <opencv2/imgproc.hpp>
 #include <opencv2/highgui.hpp>
 
+#include <chrono>
+#include <thread>
+
 /**
  * P4 - Image Segmentation
  * Ivan González Domínguez
@@ -13,27 +17,29 @@
  */
 
 MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent),
-    ui(new Ui::MainWindow)
+    ui(new Ui::MainWindow), calidadActiva(false), ejecutor(planificador, 3), ranuras(ejecutor.numRanuras()),
+    segmentarPipeline(false), adaptativaPipeline(false), fpsPipeline(30), hayPresentado(false), parandoPipeline(false),
+    nivelMostrado(-1), costeMostrado(0)
 {
     ui->setupUi(this);
 
-    cap = new VideoCapture(0);
+    resolucion = Size(320, 240);
+    escalaVisor = 1.f;
+
+    //Captura en su propio hilo sobre buffers reservados de antemano
+    captura = new Captura(0, resolucion);
+    //Las franjas de union-find usan los mismos hilos que el pipeline
+    segmentador.setPlanificador(&planificador);
+    segmentadorROI.setPlanificador(&planificador);
     winSelected = false;
     selectColorImage = false;
-    initVecinos();
-
-    //Inicializacion de imagenes
-    colorImage.create(240, 320, CV_8UC3);
-    grayImage.create(240, 320, CV_8UC1);
-    destColorImage.create(240, 320, CV_8UC3);
-    destGrayImage.create(240, 320, CV_8UC1);
-    canny_image.create(240, 320, CV_8UC1);
-    detected_edges.create(240, 320, CV_8UC1);
-    imgRegiones.create(240,320, CV_32SC1);
-    imgMask.create(240, 320, CV_8UC1);
+
+    inicializarImagenes();
 
     visorS = new ImgViewer(&grayImage, ui->imageFrameS);
     visorD = new ImgViewer(&destGrayImage, ui->imageFrameD);
+    visorS->setZeroCopy(true);
+    visorD->setZeroCopy(true);
 
     connect(&timer, SIGNAL(timeout()), this, SLOT(compute()));
     connect(ui->captureButton, SIGNAL(clicked(bool)), this, SLOT(start_stop_capture(bool)));
@@ -44,52 +50,381 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent),
     connect(ui->loadButton, SIGNAL(pressed()), this, SLOT(loadFromFile()));
 
     connect(ui->showBottomUp_checkbox, SIGNAL(clicked()), this, SLOT(segmentation()));
+    connect(ui->resolution_combo, SIGNAL(currentIndexChanged(int)), this, SLOT(change_resolution(int)));
+    connect(ui->timing_checkbox, SIGNAL(clicked(bool)), this, SLOT(change_timing(bool)));
+    connect(&timerVolcado, SIGNAL(timeout()), this, SLOT(volcarTiempos()));
+    connect(ui->pipeline_checkbox, SIGNAL(clicked(bool)), this, SLOT(change_pipeline(bool)));
+    connect(ui->adaptive_checkbox, SIGNAL(clicked()), this, SLOT(change_adaptive()));
+    connect(ui->fps_box, SIGNAL(valueChanged(int)), this, SLOT(change_adaptive()));
+    connect(ui->motor_combo, SIGNAL(currentIndexChanged(int)), this, SLOT(change_engine()));
+    connect(ui->showFloatingRange_checkbox, SIGNAL(clicked()), this, SLOT(change_engine()));
+    change_engine();
 
 
 
+    if (ui->captureButton->isChecked())
+        captura->iniciar();
+
     timer.start(30);
 }
 
 MainWindow::~MainWindow()
 {
+    //Las etapas del pipeline usan la captura y los visores
+    detenerPipeline();
     delete ui;
-    delete cap;
+    delete captura;
     delete visorS;
     delete visorD;
 }
 
+/** Reserva las imagenes de trabajo con la resolucion actual
+ * @brief MainWindow::inicializarImagenes
+ */
+void MainWindow::inicializarImagenes()
+{
+    colorImage.create(resolucion, CV_8UC3);
+    grayImage.create(resolucion, CV_8UC1);
+    destColorImage.create(resolucion, CV_8UC3);
+    destGrayImage.create(resolucion, CV_8UC1);
+    colorImage.setTo(0);
+    grayImage.setTo(0);
+    destColorImage.setTo(0);
+    destGrayImage.setTo(0);
+    segmentador.invalidarDestino();
+}
+
+/** Escala los visores para que cualquier resolucion quepa en los marcos de 320x240
+ * @brief MainWindow::ajustarVisores
+ */
+void MainWindow::ajustarVisores()
+{
+    escalaVisor = std::min((float)ui->imageFrameS->width() / resolucion.width,
+                           (float)ui->imageFrameS->height() / resolucion.height);
+    visorS->scaleImage(escalaVisor);
+    visorD->scaleImage(escalaVisor);
+}
+
+/** Cambia la resolucion de trabajo (320x240 hasta 3840x2160)
+ * @brief MainWindow::change_resolution
+ * @param index entrada del combo, con texto "ANCHOxALTO"
+ */
+void MainWindow::change_resolution(int index)
+{
+    QStringList dim = ui->resolution_combo->itemText(index).split('x');
+    if (dim.size() != 2)
+        return;
+    resolucion = Size(dim[0].toInt(), dim[1].toInt());
+
+    //La captura reserva sus buffers con la resolucion, asi que se vuelve a crear
+    bool pipeline = ejecutor.enMarcha();
+    detenerPipeline();
+    captura->detener();
+    delete captura;
+    captura = new Captura(0, resolucion);
+    if (ui->captureButton->isChecked() && !pipeline)
+        captura->iniciar();
+
+    inicializarImagenes();
+    winSelected = false;
+    ventanas.clear();
+    change_color_gray(ui->colorButton->isChecked());
+    if (ui->captureButton->isChecked() && pipeline)
+        iniciarPipeline();
+}
+
 void MainWindow::compute()
 {
-    //Captura de imagen
+    Cronometro cronometro(Instrumentacion::MED_FRAME);
 
-    if (ui->captureButton->isChecked() && cap->isOpened())
+    //Con el pipeline la captura y la segmentacion van en los hilos del planificador
+    if (ejecutor.enMarcha())
+        mostrarPipeline();
+    else
     {
-        *cap >> colorImage;
+        //Captura de imagen
 
-        cv::resize(colorImage, colorImage, Size(320, 240));
-        cvtColor(colorImage, grayImage, COLOR_BGR2GRAY);
-        cvtColor(colorImage, colorImage, COLOR_BGR2RGB);
-    }
+        if (ui->captureButton->isChecked() && captura->isOpened())
+        {
+            //Se toma el frame mas reciente sin copiarlo; sigue siendo nuestro hasta la siguiente llamada
+            const Captura::Frame *frame = captura->ultimoFrame();
+            if (frame != NULL)
+            {
+                colorImage = frame->color;
+                grayImage = frame->gray;
+            }
+            visorS->drawText(QPoint(5, 5), QString("proc %1  desc %2").arg(captura->getProcesados()).arg(captura->getDescartados()), qRound(8 / escalaVisor), Qt::yellow);
+        }
 
-    if(ui->showBottomUp_checkbox->isChecked()){
-        segmentation();
+        if(ui->showBottomUp_checkbox->isChecked()){
+            segmentation();
+            if(ui->incremental_checkbox->isChecked() && ventanasActivas().empty()){
+                const Segmentador::Telemetria &t = segmentador.getTelemetria();
+                visorD->drawText(QPoint(5, 5), QString("rec %1%  bloques %2/%3").arg(100.0 * t.fraccion, 0, 'f', 1)
+                                 .arg(t.bloquesRecalculados).arg(t.bloques), qRound(8 / escalaVisor), Qt::yellow);
+            }
+            if(ui->adaptive_checkbox->isChecked() && ventanasActivas().empty())
+                dibujarCalidad(calidad.nivel(), calidad.getMediaMs());
+        }
     }
 
+    if (Instrumentacion::activa())
+        dibujarTiempos();
+
 
-    if (winSelected)
+    for (size_t i = 0; i < ventanas.size(); i++)
     {
-        visorS->drawSquare(QPointF(imageWindow.x + imageWindow.width / 2, imageWindow.y + imageWindow.height / 2), imageWindow.width, imageWindow.height, Qt::green);
+        const Rect &v = ventanas[i];
+        visorS->drawSquare(QPointF(v.x + v.width / 2, v.y + v.height / 2), v.width, v.height, Qt::green);
     }
     visorS->update();
     visorD->update();
 }
 
+/** Muestra el ultimo frame presentado por el pipeline y le pasa los parametros de la interfaz
+ * @brief MainWindow::mostrarPipeline
+ */
+void MainWindow::mostrarPipeline()
+{
+    publicarParametros();
+    {
+        //Solo se intercambian cabeceras: el siguiente frame se presenta en los buffers que se dejan de mostrar
+        std::lock_guard<std::mutex> l(mPresentado);
+        if (hayPresentado)
+        {
+            cv::swap(colorImage, presentado.entrada.color);
+            cv::swap(grayImage, presentado.entrada.gray);
+            cv::swap(destColorImage, presentado.destColor);
+            cv::swap(destGrayImage, presentado.destGray);
+            telemetriaMostrada = presentado.telemetria;
+            estadisticasMostradas = presentado.estadisticas;
+            nivelMostrado = presentado.nivelCalidad;
+            costeMostrado = presentado.costeMs;
+            hayPresentado = false;
+        }
+    }
+
+    EjecutorFrames::Resumen r;
+    ejecutor.resumen(r);
+    int tam = qRound(8 / escalaVisor);
+    visorS->drawText(QPoint(5, 5), QString("%1 fps  lat %2 / %3 ms").arg(r.fps, 0, 'f', 1)
+                     .arg(r.latenciaP50Ms, 0, 'f', 1).arg(r.latenciaP99Ms, 0, 'f', 1), tam, Qt::yellow);
+    if (ui->showBottomUp_checkbox->isChecked() && ui->incremental_checkbox->isChecked())
+    {
+        const Segmentador::Telemetria &t = telemetriaMostrada;
+        visorD->drawText(QPoint(5, 5), QString("rec %1%  bloques %2/%3").arg(100.0 * t.fraccion, 0, 'f', 1)
+                         .arg(t.bloquesRecalculados).arg(t.bloques), tam, Qt::yellow);
+    }
+    if (ui->showBottomUp_checkbox->isChecked() && nivelMostrado >= 0)
+        dibujarCalidad(nivelMostrado, costeMostrado);
+}
+
+//Parametros de la interfaz para los siguientes frames del pipeline
+void MainWindow::publicarParametros()
+{
+    std::lock_guard<std::mutex> l(mParametros);
+    paramPipeline = leerParametros();
+    segmentarPipeline = ui->showBottomUp_checkbox->isChecked();
+    adaptativaPipeline = ui->adaptive_checkbox->isChecked();
+    fpsPipeline = ui->fps_box->value();
+    ventanasPipeline = ventanasActivas();
+}
+
+/** Activa el pipeline de frames; solo tiene efecto mientras se captura
+ * @brief MainWindow::change_pipeline
+ */
+void MainWindow::change_pipeline(bool activa)
+{
+    if (!ui->captureButton->isChecked())
+        return;
+    if (activa)
+    {
+        captura->detener();
+        iniciarPipeline();
+    }
+    else
+    {
+        detenerPipeline();
+        captura->iniciar();
+    }
+}
+
+/** Arranca el pipeline sobre la camara, con la captura sin su hilo
+ * @brief MainWindow::iniciarPipeline
+ */
+void MainWindow::iniciarPipeline()
+{
+    if (ejecutor.enMarcha() || !captura->isOpened())
+        return;
+    for (size_t i = 0; i < ranuras.size(); i++)
+    {
+        FramePipeline &f = ranuras[i];
+        f.entrada.color.create(resolucion, CV_8UC3);
+        f.entrada.gray.create(resolucion, CV_8UC1);
+        f.destColor = Mat::zeros(resolucion, CV_8UC3);
+        f.destGray = Mat::zeros(resolucion, CV_8UC1);
+        f.color = false;
+        f.nivelCalidad = -1;
+        f.costeMs = 0;
+    }
+    //Las imagenes mostradas pueden apuntar a un buffer de captura; como a partir de ahora se
+    //intercambian con las del frame presentado, se sustituyen por buffers propios
+    colorImage = Mat::zeros(resolucion, CV_8UC3);
+    grayImage = Mat::zeros(resolucion, CV_8UC1);
+    presentado.entrada.color = Mat::zeros(resolucion, CV_8UC3);
+    presentado.entrada.gray = Mat::zeros(resolucion, CV_8UC1);
+    presentado.destColor = Mat::zeros(resolucion, CV_8UC3);
+    presentado.destGray = Mat::zeros(resolucion, CV_8UC1);
+    hayPresentado = false;
+    nivelMostrado = -1;
+    publicarParametros();
+
+    parandoPipeline = false;
+    ejecutor.iniciar([this](int r, uint64) { return capturarRanura(r); },
+                     [this](int r, uint64) { segmentarRanura(r); },
+                     [this](int r, uint64) { presentarRanura(r); });
+}
+
+//Espera a que se presenten los frames en vuelo; despues el segmentador vuelve a ser de la interfaz
+void MainWindow::detenerPipeline()
+{
+    parandoPipeline = true;
+    ejecutor.detener();
+    parandoPipeline = false;
+}
+
+/** Etapa de captura: espera a que la camara de imagen, salvo si se esta parando el pipeline
+ * @brief MainWindow::capturarRanura
+ */
+bool MainWindow::capturarRanura(int ranura)
+{
+    while (!captura->leer(ranuras[ranura].entrada))
+    {
+        if (parandoPipeline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+/** Etapa de segmentacion, con los parametros que ha dejado compute(). El resultado se copia a
+ * la ranura porque los destinos del segmentador se reutilizan en el frame siguiente.
+ * @brief MainWindow::segmentarRanura
+ */
+void MainWindow::segmentarRanura(int ranura)
+{
+    FramePipeline &f = ranuras[ranura];
+    Segmentador::Parametros p;
+    bool segmentarFrame, adaptativa;
+    int fps;
+    std::vector<Rect> roi;
+    {
+        std::lock_guard<std::mutex> l(mParametros);
+        p = paramPipeline;
+        segmentarFrame = segmentarPipeline;
+        adaptativa = adaptativaPipeline;
+        fps = fpsPipeline;
+        roi = ventanasPipeline;
+    }
+    f.color = p.color;
+    if (!segmentarFrame)
+        return;
+    f.estadisticas = segmentar(p, adaptativa, fps, roi, f.entrada.color, f.entrada.gray, destPipelineColor, destPipelineGray);
+    if (p.color)
+        destPipelineColor.copyTo(f.destColor);
+    else
+        destPipelineGray.copyTo(f.destGray);
+    f.nivelCalidad = adaptativa && roi.empty() ? calidad.nivel() : -1;
+    f.costeMs = calidad.getMediaMs();
+    f.telemetria = roi.empty() ? segmentador.getTelemetria() : Segmentador::Telemetria();
+}
+
+/** Etapa de presentacion: deja el frame listo para que compute() lo muestre
+ * @brief MainWindow::presentarRanura
+ */
+void MainWindow::presentarRanura(int ranura)
+{
+    const FramePipeline &f = ranuras[ranura];
+    std::lock_guard<std::mutex> l(mPresentado);
+    f.entrada.color.copyTo(presentado.entrada.color);
+    f.entrada.gray.copyTo(presentado.entrada.gray);
+    if (f.color)
+        f.destColor.copyTo(presentado.destColor);
+    else
+        f.destGray.copyTo(presentado.destGray);
+    presentado.color = f.color;
+    presentado.nivelCalidad = f.nivelCalidad;
+    presentado.costeMs = f.costeMs;
+    presentado.telemetria = f.telemetria;
+    presentado.estadisticas = f.estadisticas;
+    hayPresentado = true;
+}
+
+/** Activa los tiempos por etapa, con su superposicion en visorD y el volcado cada 5 s
+ * @brief MainWindow::change_timing
+ */
+void MainWindow::change_timing(bool activa)
+{
+    if (activa)
+    {
+        Instrumentacion::reiniciar();
+        timerVolcado.start(5000);
+    }
+    else
+    {
+        timerVolcado.stop();
+        volcarTiempos();
+    }
+    Instrumentacion::activar(activa);
+}
+
+/** Escribe tiempos_etapas.json y tiempos_etapas.csv en el directorio de trabajo, y registra
+ * las estadisticas del ultimo frame para poder relacionarlas con los tiempos
+ * @brief MainWindow::volcarTiempos
+ */
+void MainWindow::volcarTiempos()
+{
+    QString base = QDir::current().filePath("tiempos_etapas");
+    if (!Instrumentacion::volcarJSON((base + ".json").toStdString()) || !Instrumentacion::volcarCSV((base + ".csv").toStdString()))
+        qDebug() << "No se pudieron escribir los tiempos en" << base;
+    mostrarListaRegiones();
+}
+
+/** Mediana y p99 de cada etapa con muestras, una linea por etapa bajo la telemetria
+ * @brief MainWindow::dibujarTiempos
+ */
+void MainWindow::dibujarTiempos()
+{
+    int tam = qRound(8 / escalaVisor);
+    int y = 5 + 2 * tam;
+    for (int m = 0; m < Instrumentacion::NUM_MEDIDAS; m++)
+    {
+        Instrumentacion::Resumen r;
+        Instrumentacion::resumen((Instrumentacion::Medida)m, r);
+        if (r.enVentana == 0)
+            continue;
+        visorD->drawText(QPoint(5, y), QString("%1 %2 / %3 ms").arg(Instrumentacion::nombre((Instrumentacion::Medida)m))
+                         .arg(r.p50Ms, 0, 'f', 2).arg(r.p99Ms, 0, 'f', 2), tam, Qt::cyan);
+        y += 2 * tam;
+    }
+}
+
 void MainWindow::start_stop_capture(bool start)
 {
     if (start)
+    {
         ui->captureButton->setText("Stop capture");
+        if (ui->pipeline_checkbox->isChecked())
+            iniciarPipeline();
+        else
+            captura->iniciar();
+    }
     else
+    {
         ui->captureButton->setText("Start capture");
+        detenerPipeline();
+        captura->detener();
+    }
 }
 
 void MainWindow::change_color_gray(bool color)
@@ -99,18 +434,24 @@ void MainWindow::change_color_gray(bool color)
         ui->colorButton->setText("Gray image");
         visorS->setImage(&colorImage);
         visorD->setImage(&destColorImage);
+        ajustarVisores();
     }
     else
     {
         ui->colorButton->setText("Color image");
         visorS->setImage(&grayImage);
         visorD->setImage(&destGrayImage);
+        ajustarVisores();
     }
 }
 
 void MainWindow::selectWindow(QPointF p, int w, int h)
 {
     QPointF pEnd;
+    //El raton da coordenadas del visor escalado; se pasan a coordenadas de imagen
+    p /= escalaVisor;
+    w = qRound(w / escalaVisor);
+    h = qRound(h / escalaVisor);
     if (w > 0 && h > 0)
     {
         imageWindow.x = p.x() - w / 2;
@@ -120,21 +461,29 @@ void MainWindow::selectWindow(QPointF p, int w, int h)
         if (imageWindow.y < 0)
             imageWindow.y = 0;
         pEnd.setX(p.x() + w / 2);
-        if (pEnd.x() >= 320)
-            pEnd.setX(319);
+        if (pEnd.x() >= resolucion.width)
+            pEnd.setX(resolucion.width - 1);
         pEnd.setY(p.y() + h / 2);
-        if (pEnd.y() >= 240)
-            pEnd.setY(239);
+        if (pEnd.y() >= resolucion.height)
+            pEnd.setY(resolucion.height - 1);
         imageWindow.width = pEnd.x() - imageWindow.x;
         imageWindow.height = pEnd.y() - imageWindow.y;
 
+        //Con Shift se anade a las anteriores (deselectWindow no las ha borrado); si ya hay
+        //tantas como admite el modo ROI se descarta la mas antigua
+        if ((int)ventanas.size() >= SegmentadorROI::MAX_ZONAS)
+            ventanas.erase(ventanas.begin());
+        ventanas.push_back(imageWindow);
         winSelected = true;
     }
 }
 
 void MainWindow::deselectWindow()
 {
+    if (QApplication::keyboardModifiers() & Qt::ShiftModifier)
+        return;
     winSelected = false;
+    ventanas.clear();
 }
 
 void MainWindow::loadFromFile()
@@ -158,7 +507,12 @@ void MainWindow::loadFromFile()
         }
         ui->captureButton->setChecked(false);
         ui->captureButton->setText("Start capture");
-        cv::resize(image, colorImage, Size(320, 240));
+        detenerPipeline();
+        captura->detener();
+        //Las imagenes pueden estar apuntando a un buffer de captura: se sueltan antes de escribir
+        colorImage.release();
+        grayImage.release();
+        cv::resize(image, colorImage, resolucion);
         cvtColor(colorImage, colorImage, COLOR_BGR2RGB);
         cvtColor(colorImage, grayImage, COLOR_RGB2GRAY);
 
@@ -166,6 +520,7 @@ void MainWindow::loadFromFile()
             colorImage.copyTo(destColorImage);
         else
             grayImage.copyTo(destGrayImage);
+        segmentador.invalidarDestino();
         connect(&timer, SIGNAL(timeout()), this, SLOT(compute()));
     }
 }
@@ -200,280 +555,116 @@ void MainWindow::saveToFile()
     connect(&timer, SIGNAL(timeout()), this, SLOT(compute()));
 }
 
-void MainWindow::initialize(){
-    //INICIALIZA PARÁMETROS COMO IMAGEN DE MÁSCARA Y HACE EL GUARDADO DE LA IMAGEN CANNY
-    int lowThreshold = 40;
-    int const maxThreshold = 120;
-    if(ui->colorButton->isChecked()){
-        // Reduce noise with a kernel 3x3
-        blur(colorImage, detected_edges, Size(3, 3));
-
-        // Canny detector
-        cv::Canny(detected_edges, canny_image, lowThreshold, maxThreshold, 3);
-        canny_image.copyTo(detected_edges);
-
-        grayImage.copyTo(destColorImage, canny_image);
-    }
-    else{
-        // Reduce noise with a kernel 3x3
-        blur(grayImage, detected_edges, Size(3, 3));
-
-        // Canny detector
-        cv::Canny(detected_edges, canny_image, lowThreshold, maxThreshold, 3);
-        canny_image.copyTo(detected_edges);
-
-        grayImage.copyTo(destGrayImage, canny_image);
-    }
-
-    //Initialize regions img  and region list
-    imgRegiones.setTo(-1);
-    listRegiones.clear();
-    //initialize mask image
-    cv::copyMakeBorder(canny_image,imgMask,1,1,1,1,1, BORDER_DEFAULT);
-
+/** Parametros de segmentacion elegidos en la interfaz; solo desde el hilo de la interfaz
+ * @brief MainWindow::leerParametros
+ */
+Segmentador::Parametros MainWindow::leerParametros()
+{
+    Segmentador::Parametros p;
+    p.maxBox = ui->max_box->value();
+    p.umbralFusion = ui->merge_box->value();
+    p.color = ui->colorButton->isChecked();
+    p.rangoFlotante = ui->showFloatingRange_checkbox->isChecked();
+    p.motor = (Segmentador::Motor)ui->motor_combo->currentIndex();
+    p.franjas = ui->parallel_checkbox->isEnabled() && ui->parallel_checkbox->isChecked() ? planificador.numHilos() : 1;
+    p.incremental = ui->incremental_checkbox->isChecked();
+    return p;
 }
 
 /** SE ENCARGA DEL PROCESAMIENTO DE LA IMAGEN
+ * Lee los parametros de la interfaz una sola vez y delega en el motor de segmentacion
  * @brief MainWindow::segmentation
  */
 void MainWindow::segmentation(){
-    initialize();
-    idReg = 0;
-    Point seedPoint;
-    int grisAcum, R_Acum, G_Acum, B_Acum;
-
-    for(int i = 0; i<imgRegiones.rows; i++){
-        for(int j = 0; j<imgRegiones.cols; j++){
-            if(imgRegiones.at<int>(i,j) == -1 && detected_edges.at<uchar>(i,j) != 255){
-                seedPoint.x = j;
-                seedPoint.y = i;
-                //Comprobación de imagen en color o grises
-                if(ui->colorButton->isChecked()){
-                    //Comprobación de punto flotante o fijo
-                    if(ui->showFloatingRange_checkbox->isChecked()){
-                        cv::floodFill(colorImage, imgMask, seedPoint,idReg, &minRect,
-                                      Scalar(ui->max_box->value(), ui->max_box->value(), ui->max_box->value()),
-                                      Scalar(ui->max_box->value(), ui->max_box->value(), ui->max_box->value()),
-                                      4|(1 << 8)| FLOODFILL_MASK_ONLY);
-                    }else{
-                        cv::floodFill(colorImage, imgMask, seedPoint,idReg, &minRect,
-                                      Scalar(ui->max_box->value(), ui->max_box->value(), ui->max_box->value()),
-                                      Scalar(ui->max_box->value(), ui->max_box->value(), ui->max_box->value()),
-                                      4|(1 << 8)| FLOODFILL_MASK_ONLY | FLOODFILL_FIXED_RANGE);
-                    }
-                }else{
-                    //Comprobación de punto fijo o flotante
-                    if(ui->showFloatingRange_checkbox->isChecked()){
-                        cv::floodFill(grayImage, imgMask, seedPoint,idReg, &minRect,Scalar(ui->max_box->value()),Scalar(ui->max_box->value()),4|(1 << 8)| FLOODFILL_MASK_ONLY);
-                    }else{
-                        cv::floodFill(grayImage, imgMask, seedPoint,idReg, &minRect,Scalar(ui->max_box->value()),Scalar(ui->max_box->value()),4|(1 << 8)| FLOODFILL_MASK_ONLY | FLOODFILL_FIXED_RANGE);
-                    }
-                }
-
-                grisAcum = 0;
-                R_Acum = 0;
-                G_Acum = 0;
-                B_Acum = 0;
-                r.nPuntos = 0;
-                for(int k = minRect.x; k < minRect.x+minRect.width; k++){ 		//columnas
-                    for(int z = minRect.y; z < minRect.y+minRect.height; z++){ 	//filas
-                        if(imgMask.at<uchar>(z+1, k+1) == 1 && imgRegiones.at<int>(z, k) == -1){
-                            r.id = idReg;
-                            r.nPuntos++;
-                            r.pIni = Point(k,z);                                //Point(columna, fila)
-                            if(ui->colorButton->isChecked()){
-                                Vec3b rgb = colorImage.at<Vec3b>(z, k);
-                                R_Acum += rgb[0];
-                                G_Acum += rgb[1];
-                                B_Acum += rgb[2];
-                            }
-                            else{
-                                grisAcum += grayImage.at<uchar>(z, k);
-                            }
-                            imgRegiones.at<int>(z, k) = idReg;
-                        }
-                    }
-                }
-                if(ui->colorButton->isChecked()){
-                    r.rgbMedio[0] = R_Acum/r.nPuntos;
-                    r.rgbMedio[1] = G_Acum/r.nPuntos;
-                    r.rgbMedio[2] = B_Acum/r.nPuntos;
-                }
-                else{
-                    r.gMedio = grisAcum / r.nPuntos;
-                }
-                listRegiones.push_back(r);
-                idReg++;
-            }
-        }
-    }
-
-    // ######### POST-PROCESAMIENTO #########
-
-    asignarBordesARegion();
-    vecinosFrontera();
-    bottomUp();
-
+    //Con el pipeline en marcha el segmentador es suyo
+    if (ejecutor.enMarcha())
+        return;
+    segmentar(leerParametros(), ui->adaptive_checkbox->isChecked(), ui->fps_box->value(), ventanasActivas(),
+              colorImage, grayImage, destColorImage, destGrayImage);
 }
-/** Metodo que agrega a la lista los puntos frontera de la imagen
- * @brief MainWindow::vecinosFrontera
- */
-void MainWindow::vecinosFrontera()
+
+//Ventanas a segmentar con ROI activo; vacio = imagen completa
+std::vector<Rect> MainWindow::ventanasActivas() const
 {
-    int vx = 0, vy = 0, id = 0;
-    for(int x = 0; x < imgRegiones.rows; x++){
-        for(int y = 0; y <imgRegiones.cols; y++){
-            for(size_t i = 0; i < vecinos.size(); i++){
-                vx = vecinos[i].x;
-                vy = vecinos[i].y;
-                if(((x + vx) < imgRegiones.rows) && ((y + vy) < imgRegiones.cols)){
-                    if(imgRegiones.at<int>(x, y) != imgRegiones.at<int>(x+vx, y+vy)){
-                        id=imgRegiones.at<int>(x, y);
-                        listRegiones[id].frontera.push_back(Point(y, x));
-                        break;
-                    }
-                }
-            }
-        }
-    }
+    return ui->roi_checkbox->isChecked() ? ventanas : std::vector<Rect>();
 }
 
-/** Metodo que visita los 8 vecinos para elegir el más similar al punto central y devuelve el identificador de region.
- * @brief MainWindow::vecinoMasSimilar
- * @param x
- * @param y
- * @return
+/** Segmenta un frame: solo las ventanas ROI si las hay, si no entero y con calidad adaptativa
+ * si esta activa. Lo llaman la interfaz o la etapa de segmentacion del pipeline, nunca los dos a la vez.
+ * @brief MainWindow::segmentar
  */
-int MainWindow::vecinoMasSimilar(int x, int y)
+const Segmentador::Estadisticas &MainWindow::segmentar(const Segmentador::Parametros &p, bool adaptativa, int fps,
+                                                       const std::vector<Rect> &ventanasROI, const Mat &color, const Mat &gray,
+                                                       Mat &destColor, Mat &destGray)
 {
-    int vx = 0, vy = 0;
-    int masSimilar = 255;
-    int resta;
-    int idReg = -1;
-    for(size_t i = 0; i < vecinos.size(); i++){
-        vx = vecinos[i].x;
-        vy = vecinos[i].y;
-        //Comprobamos dentro del rango de la imagen
-        if((x + vx) >= 0 && (y + vy) >= 0 && (x + vx) < imgRegiones.rows && (y + vy) < imgRegiones.cols){
-            if(imgRegiones.at<int>(x+vx, y+vy) != -1){
-                if(ui->colorButton->isChecked()){
-                    resta = abs(colorImage.at<uchar>(x, y) - colorImage.at<uchar>(x+vx, y+vy));
-                }
-                else{
-                    resta = abs(grayImage.at<uchar>(x, y) - grayImage.at<uchar>(x+vx, y+vy));
-                }
-                if(resta == 0){
-                    return idReg = imgRegiones.at<int>(x+vx, y+vy);
-
-                }else if(resta < masSimilar){
-                    masSimilar = resta;
-                    idReg = imgRegiones.at<int>(x+vx, y+vy);
-                }
-            }
-        }
+    //Con ventanas el coste ya es proporcional a su area y no se adapta la calidad
+    if (!ventanasROI.empty())
+    {
+        calidadActiva = false;
+        //Las ventanas se componen sobre el destino del Segmentador entero
+        segmentador.invalidarDestino();
+        segmentadorROI.setVentanas(ventanasROI);
+        return segmentadorROI.segmentation(p, color, gray, destColor, destGray);
+    }
+    if (!adaptativa)
+    {
+        calidadActiva = false;
+        segmentador.setParametros(p);
+        return segmentador.segmentation(color, gray, destColor, destGray);
+    }
+    //Cada vez que se activa empieza con la calidad maxima
+    if (!calidadActiva)
+    {
+        calidad.reiniciar();
+        calidadActiva = true;
     }
-    return idReg;
+    calidad.setObjetivo(fps);
+    return calidad.segmentar(segmentador, p, color, gray, destColor, destGray);
 }
 
-/** Inicializa la estructura de visitado de vecinos, el punto (0,0) no se inserta
- * @brief MainWindow::initVecinos
+/** Con el modo adaptativo el temporizador de la interfaz sigue el objetivo de frames/s
+ * @brief MainWindow::change_adaptive
  */
-void MainWindow::initVecinos()
+void MainWindow::change_adaptive()
 {
-    /*
-     * a  |  b  |   c
-     * d  |  p  |   e
-     * f  |  g  |   h
-     */
-
-    //  Point(columna, fila)
-    vecinos.push_back(Point(-1,-1)); //a   //Etiquetas corregidas
-    vecinos.push_back(Point( 0,-1)); //b
-    vecinos.push_back(Point(+1,-1)); //c
-    vecinos.push_back(Point(-1, 0)); //d
-    vecinos.push_back(Point(+1, 0)); //e
-    vecinos.push_back(Point(-1,+1)); //f
-    vecinos.push_back(Point( 0,+1)); //g
-    vecinos.push_back(Point(+1,+1)); //h
-
-
+    timer.setInterval(ui->adaptive_checkbox->isChecked() ? qRound(1000.0 / ui->fps_box->value()) : 30);
 }
 
-/** Asigna en destGrayImage los valores de gris medio que se encuentran en la imagen y en la lista de regiones
- * @brief MainWindow::bottomUp
- */
-void MainWindow::bottomUp()
+//Solo union-find en rango flotante etiqueta por franjas; con los demas motores Parallel no haria nada
+void MainWindow::change_engine()
 {
-    int id = 0;
-    uchar valor = 0;
-    Vec3b colorValue;
-    Mat imgGris;
-    Mat imgColor;
-    imgGris.create(240, 320, CV_8UC1);
-    imgColor.create(240,320, CV_8UC3);
-    if(ui->colorButton->isChecked()){
-        for(int y = 0; y < imgRegiones.rows; y++){
-            for(int x = 0; x <imgRegiones.cols; x++){
-                id = imgRegiones.at<int>(y,x);
-                if(id == -1){
-                    imgColor.at<uchar>(y,x) = 0;
-                }else{
-                    colorValue = listRegiones[id].rgbMedio;
-                    imgColor.at<Vec3b>(y,x) = colorValue;
-                }
-            }
-        }
-        imgColor.copyTo(destColorImage);
-    }else{
-        for(int y = 0; y < imgRegiones.rows; y++){
-            for(int x = 0; x <imgRegiones.cols; x++){
-                id = imgRegiones.at<int>(y,x);
-                if(id == -1){
-                    imgGris.at<uchar>(y,x) = 0;
-                }else{
-                    valor = listRegiones[id].gMedio;
-                    imgGris.at<uchar>(y,x) = valor;
-                }
-            }
-        }
-        imgGris.copyTo(destGrayImage);
-    }
+    bool franjas = ui->motor_combo->currentIndex() == Segmentador::MOTOR_UNIONFIND
+            && ui->showFloatingRange_checkbox->isChecked();
+    ui->parallel_checkbox->setEnabled(franjas);
+    ui->parallel_checkbox->setToolTip(franjas ? "Label horizontal strips in parallel"
+                                              : "Only the UnionFind engine with floating range labels in parallel");
 }
 
-/** Metodo encargado de asignar los bordes a una de las posibles regiones de la imagen
- * @brief MainWindow::asignarBordesARegion
- */
-void MainWindow::asignarBordesARegion()
+//Nivel de calidad adaptativa y coste medio frente al presupuesto, al pie del visor de resultado
+void MainWindow::dibujarCalidad(int nivel, double costeMs)
 {
-    int idVecino;
-    for(int i = 0; i<imgRegiones.rows; i++){
-        for(int j = 0; j<imgRegiones.cols; j++){
-            if(imgRegiones.at<int>(i,j) == - 1){
-                idVecino = vecinoMasSimilar(i, j);
-                imgRegiones.at<int>(i,j) = idVecino;
-                listRegiones[idVecino].nPuntos++;
-
-            }
-        }
-    }
+    int tam = qRound(8 / escalaVisor);
+    visorD->drawText(QPoint(5, resolucion.height - 3 * tam), QString("calidad %1 %2  %3 / %4 ms").arg(nivel)
+                     .arg(ControlCalidad::NIVELES[nivel].nombre).arg(costeMs, 0, 'f', 1)
+                     .arg(1000.0 / ui->fps_box->value(), 0, 'f', 1), tam, Qt::yellow);
 }
 
-/**
- * Asignar puntos de bordes a alguna region
- * Le asignamos el idReg del vecino que mas se parezca
+/** Registra las estadisticas del ultimo frame: trabajo de cada etapa y tamanos de region
+ * @brief MainWindow::mostrarListaRegiones
  */
 void MainWindow::mostrarListaRegiones()
 {
-    Region r;
-    qDebug()<<"Size lista regiones: "<<listRegiones.size();
-    for(size_t i = 0; i < listRegiones.size(); i++){
-        qDebug()<<"ID: "<< listRegiones[i].id;
-        qDebug()<<"Punto ini: columna:"<< listRegiones[i].pIni.x << "fila: " << listRegiones[i].pIni.y;
-        qDebug()<<"Gris medio: "<< listRegiones[i].gMedio;
-        qDebug()<<"Numero de puntos de la region: "<< listRegiones[i].nPuntos;
-
+    const Segmentador::Estadisticas &e = ejecutor.enMarcha() ? estadisticasMostradas
+                                         : ventanasActivas().empty() ? segmentador.getEstadisticas() : segmentadorROI.getEstadisticas();
+    qDebug() << "Regiones:" << e.numRegiones << "mayor:" << e.regionMayor << "px  puntos frontera:" << e.puntosFrontera;
+    qDebug() << "floodFill:" << e.llamadasFloodFill << "reescaneo minRect:" << e.pixelesRevisados
+             << "px  reclamados:" << e.pixelesReclamados << "px";
+    qDebug() << "Pixeles de borde:" << e.pixelesBorde << "sin region:" << e.bordesSinVecino;
+
+    QString histograma;
+    for(int k = 0; k < Segmentador::Estadisticas::NUM_CUBETAS; k++){
+        if(e.histogramaTamanos[k] > 0)
+            histograma += QString(" %1:%2").arg(1 << k).arg(e.histogramaTamanos[k]);
     }
+    qDebug() << "Regiones por tamano (desde px):" << qPrintable(histograma);
 }
-
-
-
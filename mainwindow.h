@@ -12,6 +12,15 @@
 #include <opencv2/calib3d/calib3d.hpp>
 
 #include <imgviewer.h>
+#include <segmentador.h>
+#include <captura.h>
+#include <planificador.h>
+#include <ejecutor.h>
+#include <calidad.h>
+#include <roi.h>
+
+#include <atomic>
+#include <mutex>
 
 #include <QtWidgets/QFileDialog>
 
@@ -37,25 +46,9 @@ class MainWindow : public QMainWindow
 
 public:
 
-    typedef struct{
-        Point point;
-        float valor;
-    } punto;
-
-    struct puntoCompare {
-        bool operator()(const punto a, const punto b) const {
-            return a.valor > b.valor;
-        }
-    };
+    typedef ::punto punto;
+    typedef ::puntoCompare puntoCompare;
 
-    typedef struct{
-        int id;
-        Point pIni;
-        int nPuntos;
-        uchar gMedio; //valor gris medio
-        Vec3b rgbMedio; //valor color medio
-        std::vector<Point> frontera;
-    }Region;
 
     explicit MainWindow(QWidget *parent = 0);
     ~MainWindow();
@@ -65,23 +58,56 @@ private:
     Ui::MainWindow *ui;
 
     QTimer timer;
+    QTimer timerVolcado;    //volcado periodico de los tiempos por etapa
 
-    VideoCapture *cap;
+    Captura *captura;
     ImgViewer *visorS, *visorD, *visorHistoS, *visorHistoD;
     Mat colorImage, grayImage, destColorImage, destGrayImage;
     bool winSelected, selectColorImage;
     Rect imageWindow;
-    int idReg;
-
-    Mat imgRegiones;
-    Mat imgMask;
-    Mat detected_edges;
-    Mat canny_image; //Mat de canny    
-    Rect minRect; //Minima ventana de los puntos modificados (añadidos a la region)
-    Region r;
-
-    std::vector<Region> listRegiones;
-    std::vector<Point> vecinos;
+    std::vector<Rect> ventanas;     //Ventanas seleccionadas, hasta SegmentadorROI::MAX_ZONAS
+
+    //Resolucion de trabajo; todas las imagenes intermedias se dimensionan a partir de ella
+    Size resolucion;
+    float escalaVisor; //escala de los visores para que la imagen quepa en su marco
+
+    //Motor de segmentacion (sin dependencias de la interfaz)
+    Segmentador segmentador;
+    //Calidad adaptativa (Adaptive); la usa quien segmenta, la interfaz o la etapa del pipeline
+    ControlCalidad calidad;
+    bool calidadActiva;
+    //Segmentacion solo dentro de las ventanas (ROI)
+    SegmentadorROI segmentadorROI;
+
+    //Pipeline de frames (Pipeline): captura, segmentacion y presentacion de frames consecutivos
+    //a la vez sobre los hilos del planificador; compute() solo muestra el ultimo presentado
+    struct FramePipeline{
+        Captura::Frame entrada;
+        Mat destColor, destGray;
+        bool color;
+        int nivelCalidad;           //-1 sin calidad adaptativa
+        double costeMs;
+        Segmentador::Telemetria telemetria;
+        Segmentador::Estadisticas estadisticas;
+    };
+    PlanificadorTareas planificador;
+    EjecutorFrames ejecutor;
+    std::vector<FramePipeline> ranuras;
+    Mat destPipelineColor, destPipelineGray;    //Destinos del segmentador, que no rotan (modo incremental)
+    std::mutex mParametros;
+    Segmentador::Parametros paramPipeline;      //Leidos de la interfaz en compute()
+    bool segmentarPipeline;
+    bool adaptativaPipeline;
+    int fpsPipeline;
+    std::vector<Rect> ventanasPipeline;
+    std::mutex mPresentado;
+    FramePipeline presentado;                   //Ultimo frame presentado y aun no mostrado
+    bool hayPresentado;
+    std::atomic<bool> parandoPipeline;
+    Segmentador::Telemetria telemetriaMostrada;
+    Segmentador::Estadisticas estadisticasMostradas;
+    int nivelMostrado;
+    double costeMostrado;
     /*
     * cornerList[0] = Point
     * cornerList[1] = Valor de Point */
@@ -101,14 +127,33 @@ public slots:
     void deselectWindow();
     void loadFromFile();
     void saveToFile();
-    void initialize();
     void segmentation();
-    void initVecinos();
-    int vecinoMasSimilar(int x, int y);
-    void vecinosFrontera();
-    void bottomUp();
-    void asignarBordesARegion();
     void mostrarListaRegiones();
+    void change_resolution(int index);
+    void change_timing(bool activa);
+    void volcarTiempos();
+    void change_pipeline(bool activa);
+    void change_adaptive();
+    void change_engine();
+
+private:
+    void inicializarImagenes();
+    void ajustarVisores();
+    void dibujarTiempos();
+    Segmentador::Parametros leerParametros();
+    const Segmentador::Estadisticas &segmentar(const Segmentador::Parametros &p, bool adaptativa, int fps,
+                                               const std::vector<Rect> &ventanasROI, const Mat &color, const Mat &gray,
+                                               Mat &destColor, Mat &destGray);
+    std::vector<Rect> ventanasActivas() const;
+    void dibujarCalidad(int nivel, double costeMs);
+    void publicarParametros();
+
+    void iniciarPipeline();
+    void detenerPipeline();
+    void mostrarPipeline();
+    bool capturarRanura(int ranura);
+    void segmentarRanura(int ranura);
+    void presentarRanura(int ranura);
 };
 
 
@@ -4,22 +4,24 @@
 #
 #-------------------------------------------------
 
-QT += core gui opengl
-
-TARGET = proyVA
-TEMPLATE = app
-
-SOURCES += main.cpp\
-        mainwindow.cpp \
-    imgviewer.cpp 
-
-HEADERS  += mainwindow.h \
-    imgviewer.h 
-
-INCLUDEPATH += /usr/local/include/opencv4
-
-CONFIG += c++11
-
-LIBS += -L/usr/local/lib -lopencv_imgproc -lopencv_core -lopencv_highgui -lopencv_features2d -lopencv_flann -lopencv_video -lopencv_videoio -lopencv_calib3d -lopencv_imgcodecs
-
-FORMS    += mainwindow.ui
+TEMPLATE = subdirs
+
+# Motor de segmentacion sin dependencias de Qt
+SUBDIRS += segmentacion
+segmentacion.subdir = segmentacion
+
+# Aplicacion grafica
+SUBDIRS += proyVA
+proyVA.file = gui.pro
+proyVA.makefile = Makefile.proyVA
+proyVA.depends = segmentacion
+
+# Segmentacion por lotes desde linea de comandos
+SUBDIRS += segbatch
+segbatch.subdir = segbatch
+segbatch.depends = segmentacion
+
+# Medidas por etapa sobre las imagenes de bench/imagenes
+SUBDIRS += bench
+bench.subdir = bench
+bench.depends = segmentacion
@@ -0,0 +1,319 @@
+#include <segmentador.h>
+#include <video.h>
+#include <resultados.h>
+
+#include <opencv2/imgcodecs/imgcodecs.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ * Segmentacion por lotes de un directorio de imagenes, sin interfaz grafica.
+ * Cada hilo tiene su propio Segmentador y toma imagenes de una lista compartida.
+ * Con -v segmenta un fichero de video frame a frame (ver ProcesadorVideo).
+ */
+
+static const int MAX_HILOS = 256;
+
+static void uso(const char *prog)
+{
+    std::cerr << "Uso: " << prog << " <dirEntrada> <dirSalida> [opciones]\n"
+              << "  -c        segmentacion en color\n"
+              << "  -f        rango flotante (por defecto fijo)\n"
+              << "  -8        etiquetado con 8-vecindad (por defecto 4)\n"
+              << "  -e <m>    motor de etiquetado: floodfill (defecto), unionfind, crecimiento\n"
+              << "  -p <n>    franjas en paralelo por imagen (solo unionfind con -f)\n"
+              << "  -m <n>    diferencia maxima (por defecto 5)\n"
+              << "  -u        igual que -e unionfind\n"
+              << "  -j <n>    fusiona regiones adyacentes con medias a <= n (por defecto sin fusion)\n"
+              << "  -k <b,a>  umbrales bajo y alto de Canny (por defecto 40,120)\n"
+              << "  -g        blur fusionado con las derivadas de Canny (algun borde puede cambiar)\n"
+              << "  -t <n>    numero de hilos, hasta 256 (por defecto todos los nucleos)\n"
+              << "  -r <WxH>  resolucion de trabajo (por defecto 320x240)\n"
+              << "  -i        modo incremental (util con -v)\n"
+              << "  -v        la entrada es un video y la salida el video segmentado (MJPG), ademas de\n"
+              << "            <salida>.csv con las regiones de cada frame; -r por defecto la del video\n"
+              << "  -b        escribe tambien etiquetas, regiones y fronteras en binario (<salida>.seg)\n"
+              << "  -s        barrido de resoluciones de 320x240 a 3840x2160, sin escribir salida\n";
+}
+
+static std::string nombreFichero(const std::string &ruta)
+{
+    size_t pos = ruta.find_last_of("/\\");
+    return pos == std::string::npos ? ruta : ruta.substr(pos + 1);
+}
+
+static bool motorPorNombre(const char *nombre, Segmentador::Motor &motor)
+{
+    if (!strcmp(nombre, "floodfill"))
+        motor = Segmentador::MOTOR_FLOODFILL;
+    else if (!strcmp(nombre, "unionfind"))
+        motor = Segmentador::MOTOR_UNIONFIND;
+    else if (!strcmp(nombre, "crecimiento"))
+        motor = Segmentador::MOTOR_CRECIMIENTO;
+    else
+        return false;
+    return true;
+}
+
+static bool leerUmbrales(const char *texto, int &bajo, int &alto)
+{
+    int b, a;
+    if (sscanf(texto, "%d,%d", &b, &a) != 2 || b < 0 || a < b)
+        return false;
+    bajo = b;
+    alto = a;
+    return true;
+}
+
+//Entero >= minimo sin nada detras, para que una opcion sin argumento no se tome como numero
+static bool leerEntero(const char *texto, int minimo, int &valor)
+{
+    char *fin;
+    long v = strtol(texto, &fin, 10);
+    if (fin == texto || *fin != '\0' || v < minimo || v > INT_MAX)
+        return false;
+    valor = (int)v;
+    return true;
+}
+
+static bool resolucionPorNombre(const char *nombre, Size &resolucion)
+{
+    int w, h;
+    if (sscanf(nombre, "%dx%d", &w, &h) != 2 || w <= 0 || h <= 0)
+        return false;
+    resolucion = Size(w, h);
+    return true;
+}
+
+/** Carga una imagen y la deja en el mismo formato que MainWindow::loadFromFile
+ * @brief cargarImagen
+ * @return false si no es una imagen valida
+ */
+static bool cargarImagen(const std::string &ruta, Size resolucion, Mat &colorImage, Mat &grayImage)
+{
+    Mat image = cv::imread(ruta);
+    if (image.empty())
+        return false;
+    cv::resize(image, colorImage, resolucion);
+    cvtColor(colorImage, colorImage, COLOR_BGR2RGB);
+    cvtColor(colorImage, grayImage, COLOR_RGB2GRAY);
+    return true;
+}
+
+/** Segmenta todas las imagenes a cada resolucion y muestra el coste por imagen y por pixel.
+ * Solo se mide la segmentacion (un hilo), la carga y el reescalado quedan fuera.
+ * @brief barridoResoluciones
+ */
+static void barridoResoluciones(const std::vector<String> &ficheros, const Segmentador::Parametros &param)
+{
+    static const Size resoluciones[] = { Size(320, 240), Size(640, 480), Size(1280, 720),
+                                         Size(1920, 1080), Size(3840, 2160) };
+
+    Segmentador segmentador;
+    segmentador.setParametros(param);
+    Mat colorImage, grayImage, destColorImage, destGrayImage;
+
+    printf("%-10s %8s %12s %10s\n", "resol.", "imagenes", "ms/imagen", "ns/pixel");
+    for (size_t r = 0; r < sizeof(resoluciones) / sizeof(resoluciones[0]); r++)
+    {
+        double segundos = 0;
+        int n = 0;
+        for (size_t i = 0; i < ficheros.size(); i++)
+        {
+            if (!cargarImagen(ficheros[i], resoluciones[r], colorImage, grayImage))
+                continue;
+            auto inicio = std::chrono::steady_clock::now();
+            segmentador.segmentation(colorImage, grayImage, destColorImage, destGrayImage);
+            segundos += std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+            n++;
+        }
+        if (n == 0)
+            continue;
+        double pixeles = (double)n * resoluciones[r].area();
+        printf("%4dx%-5d %8d %12.2f %10.2f\n", resoluciones[r].width, resoluciones[r].height, n,
+               1e3 * segundos / n, 1e9 * segundos / pixeles);
+    }
+}
+
+/** Segmenta un fichero de video entero; decodificacion, segmentacion y codificacion solapadas
+ * @brief procesarVideo
+ * @param nHilos hilos del planificador, compartidos por las etapas y las franjas
+ */
+static int procesarVideo(const std::string &entrada, const std::string &salida, const Segmentador::Parametros &param,
+                         Size resolucion, bool binario, int nHilos)
+{
+    ProcesadorVideo procesador(4, nHilos);
+    procesador.setParametros(param);
+    ProcesadorVideo::Resumen resumen;
+    if (!procesador.procesar(entrada, salida, salida + ".csv", binario ? salida + ".seg" : "", resolucion, VideoWriter::fourcc('M', 'J', 'P', 'G'), resumen))
+    {
+        std::cerr << "No se ha podido abrir " << entrada << " o escribir " << salida << std::endl;
+        return 1;
+    }
+
+    std::cout << "Frames: " << resumen.frames << "  Tiempo: " << resumen.segundos << " s" << std::endl;
+    std::cout << "Frames/s: " << resumen.fps << std::endl;
+    std::cout << "ms/frame ocupado  decodificar: " << resumen.msDecodificar << "  segmentar: " << resumen.msSegmentar
+              << "  codificar: " << resumen.msCodificar << std::endl;
+    std::cout << "Latencia ms  media: " << resumen.latenciaMediaMs << "  p99: " << resumen.latenciaP99Ms << std::endl;
+    return resumen.frames > 0 ? 0 : 2;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        uso(argv[0]);
+        return 1;
+    }
+
+    std::string dirEntrada = argv[1];
+    std::string dirSalida = argv[2];
+    Segmentador::Parametros param;
+    int nHilos = (int)std::thread::hardware_concurrency();
+    Size resolucion(320, 240);
+    bool conResolucion = false;
+    bool barrido = false;
+    bool video = false;
+    bool binario = false;
+
+    for (int i = 3; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-c"))
+            param.color = true;
+        else if (!strcmp(argv[i], "-f"))
+            param.rangoFlotante = true;
+        else if (!strcmp(argv[i], "-8"))
+            param.conectividad = 8;
+        else if (!strcmp(argv[i], "-e") && i + 1 < argc && motorPorNombre(argv[i + 1], param.motor))
+            i++;
+        else if (!strcmp(argv[i], "-m") && i + 1 < argc && leerEntero(argv[i + 1], 0, param.maxBox))
+            i++;
+        else if (!strcmp(argv[i], "-u"))
+            param.motor = Segmentador::MOTOR_UNIONFIND;
+        else if (!strcmp(argv[i], "-j") && i + 1 < argc && leerEntero(argv[i + 1], 0, param.umbralFusion))
+            i++;
+        else if (!strcmp(argv[i], "-p") && i + 1 < argc && leerEntero(argv[i + 1], 1, param.franjas))
+            i++;
+        else if (!strcmp(argv[i], "-k") && i + 1 < argc
+                 && leerUmbrales(argv[i + 1], param.umbralCannyBajo, param.umbralCannyAlto))
+            i++;
+        else if (!strcmp(argv[i], "-g"))
+            param.suavizadoFusionado = true;
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc && leerEntero(argv[i + 1], 1, nHilos))
+            i++;
+        else if (!strcmp(argv[i], "-r") && i + 1 < argc && resolucionPorNombre(argv[i + 1], resolucion))
+        {
+            conResolucion = true;
+            i++;
+        }
+        else if (!strcmp(argv[i], "-i"))
+            param.incremental = true;
+        else if (!strcmp(argv[i], "-v"))
+            video = true;
+        else if (!strcmp(argv[i], "-b"))
+            binario = true;
+        else if (!strcmp(argv[i], "-s"))
+            barrido = true;
+        else
+        {
+            uso(argv[0]);
+            return 1;
+        }
+    }
+    if (nHilos == 0)
+        nHilos = 1;
+    nHilos = std::min(nHilos, MAX_HILOS);
+
+    if (video)
+        return procesarVideo(dirEntrada, dirSalida, param, conResolucion ? resolucion : Size(), binario, nHilos);
+
+    std::vector<String> ficheros;
+    cv::glob(dirEntrada + "/*", ficheros, false);
+    if (ficheros.empty())
+    {
+        std::cerr << "No hay ficheros en " << dirEntrada << std::endl;
+        return 1;
+    }
+
+    if (barrido)
+    {
+        barridoResoluciones(ficheros, param);
+        return 0;
+    }
+
+    std::atomic<size_t> siguiente(0);
+    std::atomic<size_t> procesadas(0);
+    std::atomic<size_t> fallidas(0);
+
+    auto trabajador = [&]()
+    {
+        Segmentador segmentador;
+        segmentador.setParametros(param);
+        Mat colorImage, grayImage, destColorImage, destGrayImage, salida;
+
+        for (size_t i = siguiente++; i < ficheros.size(); i = siguiente++)
+        {
+            if (!cargarImagen(ficheros[i], resolucion, colorImage, grayImage))
+            {
+                fallidas++;
+                continue;
+            }
+            segmentador.segmentation(colorImage, grayImage, destColorImage, destGrayImage);
+
+            if (param.color)
+                cvtColor(destColorImage, salida, COLOR_RGB2BGR);
+            else
+                cvtColor(destGrayImage, salida, COLOR_GRAY2BGR);
+            std::string ruta = dirSalida + "/" + nombreFichero(ficheros[i]);
+            if (!cv::imwrite(ruta, salida))
+            {
+                fallidas++;
+                continue;
+            }
+            if (binario)
+            {
+                EscritorResultados escritor;
+                if (!escritor.abrir(ruta + ".seg")
+                        || !escritor.escribir(segmentador.getImgRegiones(), segmentador.getListRegiones(),
+                                              segmentador.getFronteras(), param.color, 0)
+                        || !escritor.cerrar())
+                {
+                    fallidas++;
+                    continue;
+                }
+            }
+            procesadas++;
+        }
+    };
+
+    auto inicio = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> hilos;
+    for (int t = 0; t < nHilos; t++)
+        hilos.push_back(std::thread(trabajador));
+    for (size_t t = 0; t < hilos.size(); t++)
+        hilos[t].join();
+
+    double segundos = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+
+    std::cout << "Imagenes procesadas: " << procesadas << " (" << fallidas << " fallidas)" << std::endl;
+    std::cout << "Hilos: " << nHilos << "  Tiempo: " << segundos << " s" << std::endl;
+    std::cout << "Imagenes/s: " << (segundos > 0 ? procesadas / segundos : 0.0) << std::endl;
+
+    return fallidas > 0 ? 2 : 0;
+}
@@ -0,0 +1,23 @@
+#-------------------------------------------------
+#
+# Segmentacion por lotes de directorios de imagenes
+#
+#-------------------------------------------------
+
+QT -= core gui
+
+TARGET = segbatch
+TEMPLATE = app
+
+CONFIG += console c++11 thread
+CONFIG -= qt app_bundle
+
+SOURCES += main.cpp
+
+INCLUDEPATH += /usr/local/include/opencv4
+INCLUDEPATH += $$PWD/../segmentacion
+
+LIBS += -L$$OUT_PWD/../segmentacion -lsegmentacion
+PRE_TARGETDEPS += $$OUT_PWD/../segmentacion/libsegmentacion.a
+
+LIBS += -L/usr/local/lib -lopencv_imgproc -lopencv_core -lopencv_imgcodecs -lopencv_videoio
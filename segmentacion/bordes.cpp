@@ -0,0 +1,142 @@
+#include "bordes.h"
+#include "vecindad.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ *
+ */
+
+template<int CN>
+static inline int diferencia(const uchar *a, const uchar *b)
+{
+    int d = 0;
+    for (int c = 0; c < CN; c++)
+        d = std::max(d, std::abs(a[c] - b[c]));
+    return d;
+}
+
+void AsignadorBordes::asignar(const Mat &img, Rect zona, Mat &imgRegiones, TablaRegiones &listRegiones,
+                              int &pixelesBorde, int &sinRegion)
+{
+    CV_Assert((imgRegiones.type() == CV_16SC1 || imgRegiones.type() == CV_32SC1) && img.size() == imgRegiones.size());
+    CV_Assert(img.type() == CV_8UC1 || img.type() == CV_8UC3);
+    zona &= Rect(0, 0, imgRegiones.cols, imgRegiones.rows);
+    bool cortas = etiquetasCortas(imgRegiones);
+    if (img.channels() == 3)
+    {
+        if (cortas)
+            asignarT<3, short>(img, zona, imgRegiones, listRegiones, pixelesBorde, sinRegion);
+        else
+            asignarT<3, int>(img, zona, imgRegiones, listRegiones, pixelesBorde, sinRegion);
+    }
+    else
+    {
+        if (cortas)
+            asignarT<1, short>(img, zona, imgRegiones, listRegiones, pixelesBorde, sinRegion);
+        else
+            asignarT<1, int>(img, zona, imgRegiones, listRegiones, pixelesBorde, sinRegion);
+    }
+}
+
+size_t AsignadorBordes::capacidad() const
+{
+    size_t total = 0;
+    for (int b = 0; b < NUM_CUBETAS; b++)
+        total += cubetas[b].capacity();
+    return total;
+}
+
+template<int CN, typename T>
+void AsignadorBordes::asignarT(const Mat &img, Rect zona, Mat &imgRegiones, TablaRegiones &listRegiones,
+                               int &pixelesBorde, int &sinRegion)
+{
+    const int filas = imgRegiones.rows, columnas = imgRegiones.cols;
+    pixelesBorde = 0;
+    sinRegion = 0;
+
+    //Semillas: cada pixel sin region, una vez por cada vecino con region (dentro o fuera de la zona)
+    for (int y = zona.y; y < zona.y + zona.height; y++)
+    {
+        const T *fila = imgRegiones.ptr<T>(y);
+        for (int x = zona.x; x < zona.x + zona.width; x++)
+        {
+            if (fila[x] != -1)
+                continue;
+            pixelesBorde++;
+            const uchar *centro = img.ptr<uchar>(y) + x * CN;
+            for (int k = 0; k < 8; k++)
+            {
+                int f = y + desplazamientoFila<8>(k);
+                int c = x + desplazamientoColumna<8>(k);
+                if (f < 0 || c < 0 || f >= filas || c >= columnas)
+                    continue;
+                int id = imgRegiones.ptr<T>(f)[c];
+                if (id == -1)
+                    continue;
+                Entrada e = { x, y, id };
+                cubetas[diferencia<CN>(centro, img.ptr<uchar>(f) + c * CN)].push_back(e);
+            }
+        }
+    }
+
+    //Propagacion por capas: la cubeta actual puede crecer mientras se recorre, las anteriores ya no.
+    //Dentro de una capa un pixel alcanzado por varias regiones se queda con el id menor; mientras
+    //tanto se marca como -2 - id, para que el resultado no dependa del orden de las entradas
+    int asignados = 0;
+    for (int b = 0; b < NUM_CUBETAS; b++)
+    {
+        std::vector<Entrada> &cubeta = cubetas[b];
+        size_t inicio = 0;
+        while (inicio < cubeta.size())
+        {
+            size_t fin = cubeta.size();
+            for (size_t i = inicio; i < fin; i++)
+            {
+                const Entrada &e = cubeta[i];
+                T *etiqueta = imgRegiones.ptr<T>(e.y) + e.x;
+                if (*etiqueta == -1 || (*etiqueta < -1 && -2 - *etiqueta > e.id))
+                    *etiqueta = (T)(-2 - e.id);
+            }
+            for (size_t i = inicio; i < fin; i++)
+            {
+                Entrada e = cubeta[i];
+                T *etiqueta = imgRegiones.ptr<T>(e.y) + e.x;
+                if (*etiqueta >= -1)
+                    continue;
+                int id = -2 - *etiqueta;
+                *etiqueta = (T)id;
+                asignados++;
+                //nPuntos, suma y caja tienen que seguir describiendo todos los pixeles de la region
+                const uchar *centro = img.ptr<uchar>(e.y) + e.x * CN;
+                listRegiones.nPuntos[id]++;
+                for (int c = 0; c < CN; c++)
+                {
+                    listRegiones.suma[id][c] += centro[c];
+                    listRegiones.sumaCuadrados[id][c] += centro[c] * centro[c];
+                }
+                listRegiones.caja[id] |= Rect(e.x, e.y, 1, 1);
+                for (int k = 0; k < 8; k++)
+                {
+                    int f = e.y + desplazamientoFila<8>(k);
+                    int c = e.x + desplazamientoColumna<8>(k);
+                    if (f < zona.y || c < zona.x || f >= zona.y + zona.height || c >= zona.x + zona.width)
+                        continue;
+                    if (imgRegiones.ptr<T>(f)[c] != -1)
+                        continue;
+                    int d = std::max(b, diferencia<CN>(centro, img.ptr<uchar>(f) + c * CN));
+                    Entrada n = { c, f, id };
+                    cubetas[d].push_back(n);
+                }
+            }
+            inicio = fin;
+        }
+        cubeta.clear();
+    }
+    sinRegion = pixelesBorde - asignados;
+}
@@ -0,0 +1,60 @@
+#ifndef BORDES_H
+#define BORDES_H
+
+#include <opencv2/core/core.hpp>
+
+#include <vector>
+
+#include "region.h"
+#include "etiquetas.h"
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ * Asignacion de los pixeles de borde (los que el etiquetado deja a -1) a las regiones vecinas.
+ * Es un crecimiento desde todas las regiones a la vez con una cola de 256 cubetas, una por
+ * diferencia de intensidad: cada pixel sin region entra en la cola por cada vecino (8-vecindad)
+ * con region, con la diferencia entre ambos (maxima por canal en color), y se saca en orden de
+ * cubeta. Al propagar, la prioridad es el maximo entre la del pixel de origen y el salto al
+ * nuevo, asi que nunca se inserta en una cubeta anterior a la actual y cada cubeta se vacia una
+ * sola vez: O(N + 256). Cada pixel se queda con la region del camino mas suave que llega a el,
+ * aunque el borde tenga varios pixeles de grosor. Cada cubeta se procesa por capas (la region
+ * mas cercana gana) y, dentro de una capa, gana el id menor, asi que el resultado no depende
+ * del orden de barrido. Solo quedan a -1 los pixeles a los que no llega ninguna region.
+ */
+
+using namespace cv;
+
+class AsignadorBordes
+{
+public:
+    static const int NUM_CUBETAS = 256;
+
+    /** Asigna los pixeles a -1 de la zona; los vecinos de fuera de la zona solo sirven de origen
+     * @param img entrada del etiquetado (CV_8UC1 o CV_8UC3)
+     * @param imgRegiones etiquetas CV_16SC1 o CV_32SC1 (ver etiquetas.h)
+     * @param pixelesBorde pixeles a -1 encontrados en la zona
+     * @param sinRegion los que siguen a -1 al terminar
+     */
+    void asignar(const Mat &img, Rect zona, Mat &imgRegiones, TablaRegiones &listRegiones,
+                 int &pixelesBorde, int &sinRegion);
+
+    //Capacidad reservada por las cubetas, para el contador de EspacioTrabajo
+    size_t capacidad() const;
+
+private:
+    struct Entrada{
+        int x, y;
+        int id;
+    };
+
+    std::vector<Entrada> cubetas[NUM_CUBETAS];
+
+    template<int CN, typename T>
+    void asignarT(const Mat &img, Rect zona, Mat &imgRegiones, TablaRegiones &listRegiones,
+                  int &pixelesBorde, int &sinRegion);
+};
+
+#endif // BORDES_H
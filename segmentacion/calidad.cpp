@@ -0,0 +1,134 @@
+#include "calidad.h"
+
+#include <algorithm>
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ *
+ */
+
+const ControlCalidad::Nivel ControlCalidad::NIVELES[NUM_NIVELES] = {
+    {1, 0, 0, "completa"},
+    {1, 2, 0, "max+2"},
+    {2, 2, 0, "1/2 max+2"},
+    {2, 2, 8, "1/2 max+2 8-vec"},
+    {4, 2, 8, "1/4 max+2 8-vec"}
+};
+
+const double ControlCalidad::UMBRAL_BAJAR = 0.8;
+const double ControlCalidad::UMBRAL_SUBIR = 0.6;
+const int ControlCalidad::ESPERA;
+const int ControlCalidad::SOBRECARGA;
+const int ControlCalidad::PACIENCIA;
+
+static const double ALFA = 0.25;   //peso de cada frame en la media
+
+ControlCalidad::ControlCalidad() : presupuestoMs(1000.0 / 30)
+{
+    reiniciar();
+}
+
+void ControlCalidad::reiniciar()
+{
+    actual = 0;
+    mediaMs = 0;
+    muestras = sobrecarga = holgura = 0;
+    cambios = 0;
+    nivelAnterior = -1;
+    costeAnterior = 0;
+    //Hasta medirla, la relacion es la de pixeles si cambia la resolucion y una ganancia modesta si no
+    relacion[0] = 1;
+    for (int n = 1; n < NUM_NIVELES; n++)
+    {
+        double r = (double)NIVELES[n].escala / NIVELES[n - 1].escala;
+        relacion[n] = r > 1 ? r * r : 1.3;
+    }
+}
+
+void ControlCalidad::setObjetivo(double fps)
+{
+    presupuestoMs = 1000.0 / std::max(fps, 1.0);
+}
+
+Segmentador::Parametros ControlCalidad::aplicar(const Segmentador::Parametros &param) const
+{
+    const Nivel &n = NIVELES[actual];
+    Segmentador::Parametros p = param;
+    p.maxBox += n.maxBoxExtra;
+    if (n.conectividad != 0)
+        p.conectividad = n.conectividad;
+    return p;
+}
+
+const Segmentador::Estadisticas &ControlCalidad::segmentar(Segmentador &segmentador, const Segmentador::Parametros &param,
+                                                           const Mat &color, const Mat &gray, Mat &destColorImage, Mat &destGrayImage)
+{
+    uint64_t t0 = Instrumentacion::ahoraNs();
+    Segmentador::Parametros p = aplicar(param);
+    segmentador.setParametros(p);
+    int escala = NIVELES[actual].escala;
+    if (escala == 1)
+        segmentador.segmentation(color, gray, destColorImage, destGrayImage);
+    else
+    {
+        Size reducido(std::max(color.cols / escala, 1), std::max(color.rows / escala, 1));
+        resize(color, colorReducido, reducido, 0, 0, INTER_AREA);
+        resize(gray, grayReducido, reducido, 0, 0, INTER_AREA);
+        segmentador.segmentation(colorReducido, grayReducido, destColorReducido, destGrayReducido);
+        //Sin interpolar, para no inventar colores entre regiones
+        if (p.color || p.ambasSalidas)
+            resize(destColorReducido, destColorImage, color.size(), 0, 0, INTER_NEAREST);
+        if (!p.color || p.ambasSalidas)
+            resize(destGrayReducido, destGrayImage, color.size(), 0, 0, INTER_NEAREST);
+    }
+    registrar((Instrumentacion::ahoraNs() - t0) * 1e-6);
+    return segmentador.getEstadisticas();
+}
+
+void ControlCalidad::registrar(double ms)
+{
+    mediaMs = muestras == 0 ? ms : mediaMs + ALFA * (ms - mediaMs);
+    muestras++;
+    //Los primeros frames de un nivel son segmentaciones completas (cambian los parametros) y la
+    //media aun no es fiable
+    if (muestras < ESPERA)
+        return;
+    if (muestras == ESPERA && nivelAnterior >= 0)
+    {
+        if (mediaMs > 0 && costeAnterior > 0)
+        {
+            double r = nivelAnterior < actual ? costeAnterior / mediaMs : mediaMs / costeAnterior;
+            relacion[std::max(nivelAnterior, actual)] = std::min(std::max(r, 1.0), 16.0);
+        }
+        nivelAnterior = -1;
+    }
+
+    if (mediaMs > UMBRAL_BAJAR * presupuestoMs)
+    {
+        holgura = 0;
+        if (++sobrecarga >= SOBRECARGA && actual < NUM_NIVELES - 1)
+            cambiarNivel(actual + 1);
+        return;
+    }
+    sobrecarga = 0;
+    if (actual > 0 && mediaMs * relacion[actual] < UMBRAL_SUBIR * presupuestoMs)
+    {
+        if (++holgura >= PACIENCIA)
+            cambiarNivel(actual - 1);
+    }
+    else
+        holgura = 0;
+}
+
+void ControlCalidad::cambiarNivel(int n)
+{
+    nivelAnterior = actual;
+    costeAnterior = mediaMs;
+    actual = n;
+    mediaMs = 0;
+    muestras = sobrecarga = holgura = 0;
+    cambios++;
+}
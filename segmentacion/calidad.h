@@ -0,0 +1,89 @@
+#ifndef CALIDAD_H
+#define CALIDAD_H
+
+#include <opencv2/core/core.hpp>
+
+#include "segmentador.h"
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ * Calidad adaptativa para mantener un objetivo de frames/s. Mide el coste de cada frame y,
+ * si la media reciente se acerca al presupuesto, baja un nivel de calidad: regiones mas
+ * tolerantes (maxBox mayor, menos regiones y menos trabajo por frame), resolucion de proceso
+ * reducida y 8-vecindad. Con la resolucion reducida se segmenta una copia reducida de la
+ * entrada y la salida se vuelve a ampliar al tamano original.
+ *
+ * Para no oscilar entre niveles hay histeresis: se baja tras unos pocos frames por encima
+ * del umbral alto, pero solo se sube cuando el coste previsto del nivel superior queda por
+ * debajo del umbral bajo durante muchos frames seguidos. La prevision usa la relacion de
+ * costes entre niveles medida en el ultimo cambio, que depende poco de la escena.
+ */
+
+using namespace cv;
+
+class ControlCalidad
+{
+public:
+    struct Nivel{
+        int escala;         //divisor de la resolucion de proceso
+        int maxBoxExtra;    //se suma al maxBox elegido
+        int conectividad;   //0 = la elegida
+        const char *nombre;
+    };
+
+    static const int NUM_NIVELES = 5;
+    static const Nivel NIVELES[NUM_NIVELES];    //de mas a menos calidad
+
+    static const double UMBRAL_BAJAR;   //fraccion del presupuesto a partir de la que se baja
+    static const double UMBRAL_SUBIR;   //fraccion del presupuesto que debe respetar el nivel superior
+    static const int ESPERA = 5;        //frames tras un cambio antes de volver a decidir
+    static const int SOBRECARGA = 3;    //frames seguidos sobre el umbral para bajar
+    static const int PACIENCIA = 30;    //frames seguidos con holgura para subir
+
+    ControlCalidad();
+
+    /** Vuelve a la calidad maxima y olvida las medidas */
+    void reiniciar();
+
+    void setObjetivo(double fps);
+    double getPresupuestoMs() const { return presupuestoMs; }
+
+    /** Segmenta con el nivel actual y registra lo que ha costado. destColorImage y
+     * destGrayImage quedan siempre con el tamano de la entrada.
+     */
+    const Segmentador::Estadisticas &segmentar(Segmentador &segmentador, const Segmentador::Parametros &param,
+                                               const Mat &color, const Mat &gray, Mat &destColorImage, Mat &destGrayImage);
+
+    /** Parametros del nivel actual a partir de los elegidos */
+    Segmentador::Parametros aplicar(const Segmentador::Parametros &param) const;
+
+    /** Anota el coste de un frame hecho con el nivel actual y decide el nivel del siguiente */
+    void registrar(double ms);
+
+    int nivel() const { return actual; }
+    const Nivel &getNivel() const { return NIVELES[actual]; }
+    double getMediaMs() const { return mediaMs; }
+    int getCambios() const { return cambios; }
+
+private:
+    double presupuestoMs;
+    int actual;
+    double mediaMs;             //media exponencial del coste en el nivel actual
+    int muestras;               //frames medidos desde el ultimo cambio
+    int sobrecarga, holgura;    //frames seguidos por encima / por debajo de los umbrales
+    int cambios;
+
+    //relacion[n] = coste del nivel n - 1 / coste del nivel n
+    double relacion[NUM_NIVELES];
+    int nivelAnterior;          //-1 si no hay cambio pendiente de medir
+    double costeAnterior;
+
+    Mat colorReducido, grayReducido, destColorReducido, destGrayReducido;
+
+    void cambiarNivel(int n);
+};
+
+#endif // CALIDAD_H
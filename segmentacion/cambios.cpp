@@ -0,0 +1,116 @@
+#include "cambios.h"
+
+#include <cstdlib>
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ *
+ */
+
+DetectorCambios::DetectorCambios() : tamBloque(16), nRecalcular(0), valida(false)
+{
+}
+
+void DetectorCambios::referencia(const Mat &img, int tamBloque)
+{
+    this->tamBloque = tamBloque > 0 ? tamBloque : 16;
+    img.copyTo(anterior);
+    Size tam((img.cols + this->tamBloque - 1) / this->tamBloque, (img.rows + this->tamBloque - 1) / this->tamBloque);
+    if (cambiados.size() != tam)
+    {
+        cambiados.create(tam, CV_8UC1);
+        recalcular.create(tam, CV_8UC1);
+    }
+    nRecalcular = 0;
+    valida = true;
+}
+
+Rect DetectorCambios::bloque(int by, int bx) const
+{
+    Rect b(bx * tamBloque, by * tamBloque, tamBloque, tamBloque);
+    return b & Rect(0, 0, anterior.cols, anterior.rows);
+}
+
+int DetectorCambios::comparar(const Mat &img, int umbral)
+{
+    if (!valida || img.size() != anterior.size() || img.type() != anterior.type())
+        return -1;
+
+    int cn = img.channels();
+    int nCambiados = 0;
+    for (int by = 0; by < cambiados.rows; by++)
+    {
+        uchar *cambio = cambiados.ptr<uchar>(by);
+        for (int bx = 0; bx < cambiados.cols; bx++)
+        {
+            Rect b = bloque(by, bx);
+            bool distinto = false;
+            for (int y = b.y; y < b.y + b.height && !distinto; y++)
+            {
+                const uchar *a = anterior.ptr<uchar>(y) + b.x * cn;
+                const uchar *c = img.ptr<uchar>(y) + b.x * cn;
+                for (int k = 0; k < b.width * cn; k++)
+                {
+                    if (abs(a[k] - c[k]) > umbral)
+                    {
+                        distinto = true;
+                        break;
+                    }
+                }
+            }
+            cambio[bx] = distinto;
+            nCambiados += distinto;
+        }
+    }
+
+    //Cada bloque cambiado arrastra a sus 8 vecinos
+    recalcular.setTo(0);
+    nRecalcular = 0;
+    int xMin = recalcular.cols, yMin = recalcular.rows, xMax = -1, yMax = -1;
+    for (int by = 0; by < cambiados.rows; by++)
+    {
+        for (int bx = 0; bx < cambiados.cols; bx++)
+        {
+            if (!cambiados.ptr<uchar>(by)[bx])
+                continue;
+            for (int dy = -1; dy <= 1; dy++)
+            {
+                for (int dx = -1; dx <= 1; dx++)
+                {
+                    int yy = by + dy, xx = bx + dx;
+                    if (yy < 0 || xx < 0 || yy >= recalcular.rows || xx >= recalcular.cols)
+                        continue;
+                    uchar &r = recalcular.ptr<uchar>(yy)[xx];
+                    if (!r)
+                    {
+                        r = 1;
+                        nRecalcular++;
+                        if (xx < xMin) xMin = xx;
+                        if (xx > xMax) xMax = xx;
+                        if (yy < yMin) yMin = yy;
+                        if (yy > yMax) yMax = yy;
+                    }
+                }
+            }
+        }
+    }
+    if (nRecalcular > 0)
+        zonaRecalcular = bloque(yMin, xMin) | bloque(yMax, xMax);
+    else
+        zonaRecalcular = Rect();
+    return nCambiados;
+}
+
+void DetectorCambios::actualizar(const Mat &img)
+{
+    for (int by = 0; by < recalcular.rows; by++)
+        for (int bx = 0; bx < recalcular.cols; bx++)
+            if (hayQueRecalcular(by, bx))
+            {
+                Rect b = bloque(by, bx);
+                img(b).copyTo(anterior(b));
+            }
+}
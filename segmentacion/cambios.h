@@ -0,0 +1,54 @@
+#ifndef CAMBIOS_H
+#define CAMBIOS_H
+
+#include <opencv2/core/core.hpp>
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ * Deteccion de cambios por bloques entre el frame actual y el ultimo que se segmento.
+ * Un bloque cambia si algun pixel difiere en mas del umbral en algun canal. Los bloques a
+ * recalcular son los cambiados mas sus 8 vecinos, porque blur y Canny miran fuera del bloque.
+ * La referencia solo se actualiza en los bloques recalculados, asi una deriva lenta acaba
+ * superando el umbral en lugar de perderse de frame en frame.
+ */
+
+using namespace cv;
+
+class DetectorCambios
+{
+public:
+    DetectorCambios();
+
+    /** Toma img entera como referencia (tras una segmentacion completa) */
+    void referencia(const Mat &img, int tamBloque);
+
+    /** Compara img con la referencia y marca los bloques a recalcular
+     * @return bloques cambiados, o -1 si no hay referencia compatible con img
+     */
+    int comparar(const Mat &img, int umbral);
+
+    /** Copia a la referencia los bloques marcados para recalcular */
+    void actualizar(const Mat &img);
+
+    void invalidar() { valida = false; }
+
+    int numBloques() const { return recalcular.rows * recalcular.cols; }
+    int numRecalcular() const { return nRecalcular; }
+    bool hayQueRecalcular(int by, int bx) const { return recalcular.ptr<uchar>(by)[bx] != 0; }
+    Size rejilla() const { return recalcular.size(); }
+    Rect bloque(int by, int bx) const;
+    Rect zona() const { return zonaRecalcular; }    //Rectangulo que cubre los bloques a recalcular
+
+private:
+    Mat anterior;
+    Mat cambiados, recalcular;      //Un byte por bloque
+    int tamBloque;
+    int nRecalcular;
+    Rect zonaRecalcular;
+    bool valida;
+};
+
+#endif // CAMBIOS_H
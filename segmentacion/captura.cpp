@@ -0,0 +1,129 @@
+#include "captura.h"
+#include "instrumentacion.h"
+
+#include <chrono>
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ *
+ */
+
+Captura::Captura(int dispositivo, Size tamano, int nBuffers) :
+    cap(dispositivo), tamano(tamano), frames(nBuffers), listos(nBuffers), libres(nBuffers),
+    enUso(-1), activo(false), capturados(0), procesados(0), descartados(0)
+{
+    //Se pide a la camara la resolucion de trabajo; si no la soporta se reescala cada frame
+    if (cap.isOpened())
+    {
+        cap.set(CAP_PROP_FRAME_WIDTH, tamano.width);
+        cap.set(CAP_PROP_FRAME_HEIGHT, tamano.height);
+    }
+    for (int i = 0; i < nBuffers; i++)
+    {
+        frames[i].color.create(tamano, CV_8UC3);
+        frames[i].gray.create(tamano, CV_8UC1);
+        frames[i].numero = 0;
+        libres.push(i);
+    }
+}
+
+Captura::~Captura()
+{
+    detener();
+}
+
+void Captura::iniciar()
+{
+    if (activo || !cap.isOpened())
+        return;
+    activo = true;
+    hilo = std::thread(&Captura::bucleCaptura, this);
+}
+
+void Captura::detener()
+{
+    activo = false;
+    if (hilo.joinable())
+        hilo.join();
+}
+
+/** Hilo productor: lee de la camara y publica en la cola de listos
+ * @brief Captura::bucleCaptura
+ */
+void Captura::bucleCaptura()
+{
+    Mat bruto;
+    while (activo)
+    {
+        bool leido;
+        {
+            Cronometro c(Instrumentacion::MED_CAPTURA);
+            leido = cap.read(bruto) && !bruto.empty();
+        }
+        if (!leido)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            continue;
+        }
+
+        //Sin buffers libres el consumidor va atrasado: se descarta este frame
+        int i;
+        if (!libres.pop(i))
+        {
+            descartados++;
+            continue;
+        }
+
+        convertir(bruto, frames[i]);
+        listos.push(i);
+    }
+}
+
+bool Captura::leer(Frame &f)
+{
+    {
+        Cronometro c(Instrumentacion::MED_CAPTURA);
+        if (!cap.read(leido) || leido.empty())
+            return false;
+    }
+    convertir(leido, f);
+    procesados++;
+    return true;
+}
+
+/** Redimensiona y convierte (RGB y grises) un frame leido sobre los buffers de f
+ * @brief Captura::convertir
+ */
+void Captura::convertir(const Mat &bruto, Frame &f)
+{
+    Cronometro c(Instrumentacion::MED_CONVERSION);
+    cv::resize(bruto, f.color, tamano);
+    cvtColor(f.color, f.gray, COLOR_BGR2GRAY);
+    cvtColor(f.color, f.color, COLOR_BGR2RGB);
+    f.numero = ++capturados;
+}
+
+const Captura::Frame *Captura::ultimoFrame()
+{
+    int i, ultimo = -1;
+    while (listos.pop(i))
+    {
+        if (ultimo >= 0)
+        {
+            libres.push(ultimo);
+            descartados++;
+        }
+        ultimo = i;
+    }
+    if (ultimo < 0)
+        return NULL;
+
+    if (enUso >= 0)
+        libres.push(enUso);
+    enUso = ultimo;
+    procesados++;
+    return &frames[enUso];
+}
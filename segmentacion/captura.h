@@ -0,0 +1,75 @@
+#ifndef CAPTURA_H
+#define CAPTURA_H
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/videoio/videoio.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "colaspsc.h"
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ * Captura de camara en un hilo propio. Cada imagen se lee, se redimensiona y se convierte
+ * (RGB y grises) sobre un conjunto fijo de buffers reservados al construir. Los buffers
+ * listos se publican en una cola SPSC y el consumidor toma el mas reciente sin copiarlo;
+ * los que se quedan atras se devuelven al productor y cuentan como descartados.
+ * Como etapa de un pipeline (ver ejecutor.h) se usa leer, sin arrancar el hilo.
+ */
+
+using namespace cv;
+
+class Captura
+{
+public:
+    struct Frame{
+        Mat color;          //CV_8UC3, RGB
+        Mat gray;           //CV_8UC1
+        uint64 numero;      //orden de captura
+    };
+
+    Captura(int dispositivo, Size tamano, int nBuffers = 4);
+    ~Captura();
+
+    bool isOpened() const { return cap.isOpened(); }
+    void iniciar();
+    void detener();
+
+    /** Devuelve el frame mas reciente, o NULL si no ha llegado ninguno nuevo. El frame es valido
+     * hasta la siguiente llamada, que lo devuelve al hilo de captura. Solo desde el consumidor.
+     */
+    const Frame *ultimoFrame();
+
+    /** Lee un frame de la camara sobre f, en el hilo que llama; no se mezcla con iniciar
+     * @return false si la camara no ha dado imagen
+     */
+    bool leer(Frame &f);
+
+    uint64 getCapturados() const { return capturados.load(); }
+    uint64 getProcesados() const { return procesados.load(); }
+    uint64 getDescartados() const { return descartados.load(); }
+
+private:
+    VideoCapture cap;
+    Size tamano;
+    std::vector<Frame> frames;
+    ColaSPSC<int> listos;       //productor -> consumidor
+    ColaSPSC<int> libres;       //consumidor -> productor
+    int enUso;                  //buffer que tiene el consumidor, -1 si ninguno
+    Mat leido;                  //ultimo frame de leer, sin convertir
+
+    std::thread hilo;
+    std::atomic<bool> activo;
+    std::atomic<uint64> capturados, procesados, descartados;
+
+    void bucleCaptura();
+    void convertir(const Mat &bruto, Frame &f);
+};
+
+#endif // CAPTURA_H
@@ -0,0 +1,53 @@
+#ifndef COLASPSC_H
+#define COLASPSC_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ * Cola circular sin bloqueos para un unico productor y un unico consumidor.
+ * push solo se llama desde el hilo productor y pop solo desde el consumidor.
+ */
+
+template<typename T>
+class ColaSPSC
+{
+public:
+    explicit ColaSPSC(size_t capacidad) : buffer(capacidad + 1), cabeza(0), cola(0) {}
+
+    bool push(const T &valor)
+    {
+        size_t c = cola.load(std::memory_order_relaxed);
+        size_t siguiente = (c + 1) % buffer.size();
+        if (siguiente == cabeza.load(std::memory_order_acquire))
+            return false;       //llena
+        buffer[c] = valor;
+        cola.store(siguiente, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &valor)
+    {
+        size_t h = cabeza.load(std::memory_order_relaxed);
+        if (h == cola.load(std::memory_order_acquire))
+            return false;       //vacia
+        valor = buffer[h];
+        cabeza.store((h + 1) % buffer.size(), std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::vector<T> buffer;
+    std::atomic<size_t> cabeza;     //siguiente posicion a leer (consumidor)
+    std::atomic<size_t> cola;       //siguiente posicion a escribir (productor)
+
+    ColaSPSC(const ColaSPSC &);
+    ColaSPSC &operator=(const ColaSPSC &);
+};
+
+#endif // COLASPSC_H
@@ -0,0 +1,229 @@
+#include "crecimiento.h"
+#include "vecindad.h"
+
+#include <cstdlib>
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ *
+ */
+
+template<int CN>
+static inline bool dentroDeRango(const uchar *a, const uchar *b, int maxDif)
+{
+    for (int c = 0; c < CN; c++)
+        if (abs(a[c] - b[c]) > maxDif)
+            return false;
+    return true;
+}
+
+//Combinacion de canales, rango y conectividad para elegir el nucleo especializado
+static inline int nucleo(const Mat &img, bool rangoFlotante, int conectividad)
+{
+    return (img.channels() == 3 ? 4 : 0) | (rangoFlotante ? 2 : 0) | (conectividad == 8 ? 1 : 0);
+}
+
+bool CrecimientoRegiones::etiquetar(const Mat &img, const Mat &bordes, int maxDif, bool rangoFlotante, int conectividad,
+                                    Mat &imgRegiones, TablaRegiones &listRegiones)
+{
+    CV_Assert(img.type() == CV_8UC1 || img.type() == CV_8UC3);
+    CV_Assert(bordes.type() == CV_8UC1 && bordes.rows == img.rows && bordes.cols == img.cols);
+    CV_Assert(conectividad == 4 || conectividad == 8);
+
+    imgRegiones.create(img.rows, img.cols, tipoEtiquetas(imgRegiones));
+    imgRegiones.setTo(-1);
+    listRegiones.clear();
+
+    if (etiquetasCortas(imgRegiones))
+        return etiquetarAncho<short>(img, bordes, maxDif, rangoFlotante, conectividad, imgRegiones, listRegiones);
+    return etiquetarAncho<int>(img, bordes, maxDif, rangoFlotante, conectividad, imgRegiones, listRegiones);
+}
+
+bool CrecimientoRegiones::etiquetarZona(const Mat &img, const Mat &bordes, int maxDif, bool rangoFlotante, int conectividad,
+                                        Rect zona, Mat &imgRegiones, TablaRegiones &listRegiones,
+                                        std::vector<int> &idsLibres, int &nuevas)
+{
+    CV_Assert(img.type() == CV_8UC1 || img.type() == CV_8UC3);
+    CV_Assert((imgRegiones.type() == CV_16SC1 || imgRegiones.type() == CV_32SC1) && imgRegiones.size() == img.size());
+    CV_Assert(conectividad == 4 || conectividad == 8);
+
+    zona &= Rect(0, 0, img.cols, img.rows);
+    if (etiquetasCortas(imgRegiones))
+        return etiquetarZonaAncho<short>(img, bordes, maxDif, rangoFlotante, conectividad, zona, imgRegiones,
+                                         listRegiones, idsLibres, nuevas);
+    return etiquetarZonaAncho<int>(img, bordes, maxDif, rangoFlotante, conectividad, zona, imgRegiones,
+                                   listRegiones, idsLibres, nuevas);
+}
+
+template<typename T>
+bool CrecimientoRegiones::etiquetarAncho(const Mat &img, const Mat &bordes, int maxDif, bool rangoFlotante,
+                                         int conectividad, Mat &imgRegiones, TablaRegiones &listRegiones)
+{
+    switch (nucleo(img, rangoFlotante, conectividad))
+    {
+    case 0: return etiquetarTodo<1, false, 4, T>(img, bordes, maxDif, imgRegiones, listRegiones);
+    case 1: return etiquetarTodo<1, false, 8, T>(img, bordes, maxDif, imgRegiones, listRegiones);
+    case 2: return etiquetarTodo<1, true, 4, T>(img, bordes, maxDif, imgRegiones, listRegiones);
+    case 3: return etiquetarTodo<1, true, 8, T>(img, bordes, maxDif, imgRegiones, listRegiones);
+    case 4: return etiquetarTodo<3, false, 4, T>(img, bordes, maxDif, imgRegiones, listRegiones);
+    case 5: return etiquetarTodo<3, false, 8, T>(img, bordes, maxDif, imgRegiones, listRegiones);
+    case 6: return etiquetarTodo<3, true, 4, T>(img, bordes, maxDif, imgRegiones, listRegiones);
+    default: return etiquetarTodo<3, true, 8, T>(img, bordes, maxDif, imgRegiones, listRegiones);
+    }
+}
+
+template<typename T>
+bool CrecimientoRegiones::etiquetarZonaAncho(const Mat &img, const Mat &bordes, int maxDif, bool rangoFlotante,
+                                             int conectividad, Rect zona, Mat &imgRegiones, TablaRegiones &listRegiones,
+                                             std::vector<int> &idsLibres, int &nuevas)
+{
+    switch (nucleo(img, rangoFlotante, conectividad))
+    {
+    case 0: return etiquetarZonaT<1, false, 4, T>(img, bordes, maxDif, zona, imgRegiones, listRegiones, idsLibres, nuevas);
+    case 1: return etiquetarZonaT<1, false, 8, T>(img, bordes, maxDif, zona, imgRegiones, listRegiones, idsLibres, nuevas);
+    case 2: return etiquetarZonaT<1, true, 4, T>(img, bordes, maxDif, zona, imgRegiones, listRegiones, idsLibres, nuevas);
+    case 3: return etiquetarZonaT<1, true, 8, T>(img, bordes, maxDif, zona, imgRegiones, listRegiones, idsLibres, nuevas);
+    case 4: return etiquetarZonaT<3, false, 4, T>(img, bordes, maxDif, zona, imgRegiones, listRegiones, idsLibres, nuevas);
+    case 5: return etiquetarZonaT<3, false, 8, T>(img, bordes, maxDif, zona, imgRegiones, listRegiones, idsLibres, nuevas);
+    case 6: return etiquetarZonaT<3, true, 4, T>(img, bordes, maxDif, zona, imgRegiones, listRegiones, idsLibres, nuevas);
+    default: return etiquetarZonaT<3, true, 8, T>(img, bordes, maxDif, zona, imgRegiones, listRegiones, idsLibres, nuevas);
+    }
+}
+
+/** Busca semillas en orden de barrido, igual que Segmentador::etiquetadoFloodFill
+ * @brief CrecimientoRegiones::etiquetarTodo
+ */
+template<int CN, bool FLOTANTE, int CONEX, typename T>
+bool CrecimientoRegiones::etiquetarTodo(const Mat &img, const Mat &bordes, int maxDif,
+                                        Mat &imgRegiones, TablaRegiones &listRegiones)
+{
+    for (int i = 0; i < img.rows; i++)
+    {
+        const T *etiqueta = imgRegiones.ptr<T>(i);
+        const uchar *borde = bordes.ptr<uchar>(i);
+        for (int j = 0; j < img.cols; j++)
+        {
+            if (etiqueta[j] == -1 && borde[j] != 255)
+            {
+                if ((int)listRegiones.size() >= Etiquetas<T>::MAX_REGIONES)
+                    return false;
+                int id = listRegiones.anadir();
+                crecer<CN, FLOTANTE, CONEX, T>(img, bordes, maxDif, Point(j, i), imgRegiones, listRegiones, id);
+            }
+        }
+    }
+    return true;
+}
+
+/** Si se acaban los ids se para antes de la semilla que no cabe; como todo lo anterior en
+ * orden de barrido ya esta etiquetado, otra llamada con imgRegiones promovida sigue por ella
+ * @brief CrecimientoRegiones::etiquetarZonaT
+ */
+template<int CN, bool FLOTANTE, int CONEX, typename T>
+bool CrecimientoRegiones::etiquetarZonaT(const Mat &img, const Mat &bordes, int maxDif, Rect zona, Mat &imgRegiones,
+                                         TablaRegiones &listRegiones, std::vector<int> &idsLibres, int &nuevas)
+{
+    size_t usados = 0;
+    bool completa = true;
+
+    for (int i = zona.y; i < zona.y + zona.height && completa; i++)
+    {
+        const T *etiqueta = imgRegiones.ptr<T>(i);
+        const uchar *borde = bordes.ptr<uchar>(i);
+        for (int j = zona.x; j < zona.x + zona.width; j++)
+        {
+            if (etiqueta[j] == -1 && borde[j] != 255)
+            {
+                if (usados == idsLibres.size() && (int)listRegiones.size() >= Etiquetas<T>::MAX_REGIONES)
+                {
+                    completa = false;
+                    break;
+                }
+                int id = usados < idsLibres.size() ? idsLibres[usados++] : listRegiones.anadir();
+                crecer<CN, FLOTANTE, CONEX, T>(img, bordes, maxDif, Point(j, i), imgRegiones, listRegiones, id);
+                nuevas++;
+            }
+        }
+    }
+    idsLibres.erase(idsLibres.begin(), idsLibres.begin() + usados);
+    return completa;
+}
+
+/** Reclama la region de la semilla y deja sus estadisticas en la entrada id de la tabla
+ * @brief CrecimientoRegiones::crecer
+ */
+template<int CN, bool FLOTANTE, int CONEX, typename T>
+void CrecimientoRegiones::crecer(const Mat &img, const Mat &bordes, int maxDif, Point semilla,
+                                 Mat &imgRegiones, TablaRegiones &listRegiones, int id)
+{
+    const uchar *valorSemilla = img.ptr<uchar>(semilla.y) + semilla.x * CN;
+    int64 suma[CN], sumaCuadrados[CN];
+    for (int c = 0; c < CN; c++)
+        suma[c] = sumaCuadrados[c] = 0;
+    int nPuntos = 0;
+    int xMin = semilla.x, xMax = semilla.x, yMin = semilla.y, yMax = semilla.y;
+
+    pila.clear();
+    imgRegiones.at<T>(semilla) = (T)id;
+    pila.push_back(semilla);
+
+    while (!pila.empty())
+    {
+        Point p = pila.back();
+        pila.pop_back();
+
+        const uchar *valor = img.ptr<uchar>(p.y) + p.x * CN;
+        nPuntos++;
+        for (int c = 0; c < CN; c++)
+        {
+            suma[c] += valor[c];
+            sumaCuadrados[c] += valor[c] * valor[c];
+        }
+        if (p.x < xMin) xMin = p.x;
+        if (p.x > xMax) xMax = p.x;
+        if (p.y < yMin) yMin = p.y;
+        if (p.y > yMax) yMax = p.y;
+
+        //Rango fijo: se compara con la semilla; flotante: con el pixel que se expande
+        const uchar *referencia = FLOTANTE ? valor : valorSemilla;
+        for (int k = 0; k < CONEX; k++)
+        {
+            int qx = p.x + desplazamientoColumna<CONEX>(k);
+            int qy = p.y + desplazamientoFila<CONEX>(k);
+            if (qx < 0 || qy < 0 || qx >= img.cols || qy >= img.rows)
+                continue;
+            T &etiqueta = imgRegiones.ptr<T>(qy)[qx];
+            if (etiqueta != -1 || bordes.ptr<uchar>(qy)[qx] == 255)
+                continue;
+            if (dentroDeRango<CN>(img.ptr<uchar>(qy) + qx * CN, referencia, maxDif))
+            {
+                etiqueta = (T)id;
+                pila.push_back(Point(qx, qy));
+            }
+        }
+    }
+
+    listRegiones.pIni[id] = semilla;
+    listRegiones.nPuntos[id] = nPuntos;
+    listRegiones.caja[id] = Rect(xMin, yMin, xMax - xMin + 1, yMax - yMin + 1);
+    Vec3d &s = listRegiones.suma[id], &s2 = listRegiones.sumaCuadrados[id];
+    s = s2 = Vec3d(0, 0, 0);
+    for (int c = 0; c < CN; c++)
+    {
+        s[c] = (double)suma[c];
+        s2[c] = (double)sumaCuadrados[c];
+    }
+    //Un id reutilizado no debe conservar la media del otro modo
+    listRegiones.gMedio[id] = 0;
+    listRegiones.rgbMedio[id] = Vec3b(0, 0, 0);
+    if (CN == 3)
+    {
+        for (int c = 0; c < CN; c++)
+            listRegiones.rgbMedio[id][c] = (uchar)(suma[c] / nPuntos);
+    }
+    else
+        listRegiones.gMedio[id] = (uchar)(suma[0] / nPuntos);
+}
@@ -0,0 +1,74 @@
+#ifndef CRECIMIENTO_H
+#define CRECIMIENTO_H
+
+#include <opencv2/core/core.hpp>
+
+#include <vector>
+
+#include "region.h"
+#include "etiquetas.h"
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ * Crecimiento de regiones desde cada semilla (4 u 8-vecindad) con el mismo criterio que
+ * cv::floodFill en rango fijo o flotante. Las estadisticas de cada region (puntos, suma,
+ * suma de cuadrados, caja y semilla) se acumulan al reclamar cada pixel, de modo que la
+ * lista de regiones esta completa al acabar el crecimiento: no hay reescaneo de minRect
+ * ni mascara que limpiar, la propia imagen de etiquetas marca los pixeles ya asignados.
+ */
+
+using namespace cv;
+
+class CrecimientoRegiones
+{
+public:
+    /** Etiqueta la imagen y rellena imgRegiones (-1 en bordes) y listRegiones. imgRegiones
+     * conserva su tipo de etiqueta si ya lo tenia (ver etiquetas.h); si no, sale en CV_32SC1.
+     * @param img imagen CV_8UC1 o CV_8UC3
+     * @param bordes mascara CV_8UC1, los pixeles a 255 no se etiquetan
+     * @param conectividad 4 u 8
+     * @return false si las regiones no caben en el tipo de imgRegiones; hay que promoverla y repetir
+     */
+    bool etiquetar(const Mat &img, const Mat &bordes, int maxDif, bool rangoFlotante, int conectividad,
+                   Mat &imgRegiones, TablaRegiones &listRegiones);
+
+    /** Crece regiones nuevas solo desde los pixeles a -1 de zona, respetando las ya etiquetadas
+     * @param idsLibres ids a reutilizar en orden; los usados se quitan, el resto se numera al final
+     * @param nuevas se le suman las regiones creadas
+     * @return false si se ha parado porque no caben mas regiones en imgRegiones; lo etiquetado
+     * es valido y otra llamada con imgRegiones promovida termina la zona
+     */
+    bool etiquetarZona(const Mat &img, const Mat &bordes, int maxDif, bool rangoFlotante, int conectividad, Rect zona,
+                       Mat &imgRegiones, TablaRegiones &listRegiones, std::vector<int> &idsLibres, int &nuevas);
+
+    //Capacidad reservada por la pila, para el contador de EspacioTrabajo
+    size_t capacidad() const { return pila.capacity(); }
+
+private:
+    std::vector<Point> pila;        //Pixeles reclamados pendientes de expandir
+
+    template<typename T>
+    bool etiquetarAncho(const Mat &img, const Mat &bordes, int maxDif, bool rangoFlotante, int conectividad,
+                        Mat &imgRegiones, TablaRegiones &listRegiones);
+
+    template<typename T>
+    bool etiquetarZonaAncho(const Mat &img, const Mat &bordes, int maxDif, bool rangoFlotante, int conectividad,
+                            Rect zona, Mat &imgRegiones, TablaRegiones &listRegiones, std::vector<int> &idsLibres,
+                            int &nuevas);
+
+    template<int CN, bool FLOTANTE, int CONEX, typename T>
+    void crecer(const Mat &img, const Mat &bordes, int maxDif, Point semilla, Mat &imgRegiones,
+                TablaRegiones &listRegiones, int id);
+
+    template<int CN, bool FLOTANTE, int CONEX, typename T>
+    bool etiquetarTodo(const Mat &img, const Mat &bordes, int maxDif, Mat &imgRegiones, TablaRegiones &listRegiones);
+
+    template<int CN, bool FLOTANTE, int CONEX, typename T>
+    bool etiquetarZonaT(const Mat &img, const Mat &bordes, int maxDif, Rect zona, Mat &imgRegiones,
+                        TablaRegiones &listRegiones, std::vector<int> &idsLibres, int &nuevas);
+};
+
+#endif // CRECIMIENTO_H
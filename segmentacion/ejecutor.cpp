@@ -0,0 +1,170 @@
+#include "ejecutor.h"
+#include "instrumentacion.h"
+
+#include <algorithm>
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ *
+ */
+
+const int EjecutorFrames::VENTANA;
+
+EjecutorFrames::EjecutorFrames(PlanificadorTareas &planificador, int nRanuras) :
+    planificador(planificador), nRanuras(std::max(nRanuras, 1)), activo(false), sinCaptura(true),
+    inicioFrame(this->nRanuras, 0), nsInicio(0), nsUltimo(0), maxEnVuelo(0), sumaLatencias(0), maxLatencia(0)
+{
+    for (int e = 0; e < NUM_ETAPAS; e++)
+    {
+        ocupada[e] = false;
+        siguiente[e] = 0;
+        nsEtapa[e] = 0;
+    }
+    latencias.reserve(VENTANA);
+}
+
+EjecutorFrames::~EjecutorFrames()
+{
+    detener();
+}
+
+void EjecutorFrames::iniciar(const FuncionCaptura &capturar, const FuncionEtapa &segmentar, const FuncionEtapa &presentar)
+{
+    std::lock_guard<std::mutex> l(m);
+    CV_Assert(!activo);
+    this->capturar = capturar;
+    this->segmentar = segmentar;
+    this->presentar = presentar;
+    for (int e = 0; e < NUM_ETAPAS; e++)
+    {
+        siguiente[e] = 0;
+        nsEtapa[e] = 0;
+    }
+    latencias.clear();
+    sumaLatencias = maxLatencia = 0;
+    maxEnVuelo = 0;
+    nsInicio = nsUltimo = Instrumentacion::ahoraNs();
+    activo = true;
+    sinCaptura = false;
+    despachar();
+}
+
+void EjecutorFrames::detener()
+{
+    std::unique_lock<std::mutex> l(m);
+    if (!activo)
+        return;
+    sinCaptura = true;
+    despachar();
+    terminado.wait(l, [this] { return !activo; });
+}
+
+void EjecutorFrames::esperar()
+{
+    std::unique_lock<std::mutex> l(m);
+    terminado.wait(l, [this] { return !activo; });
+}
+
+bool EjecutorFrames::enMarcha() const
+{
+    std::lock_guard<std::mutex> l(m);
+    return activo;
+}
+
+/** Lanza cada etapa libre que tenga frame listo; con el cerrojo tomado
+ * @brief EjecutorFrames::despachar
+ */
+void EjecutorFrames::despachar()
+{
+    for (int e = 0; e < NUM_ETAPAS; e++)
+    {
+        if (ocupada[e])
+            continue;
+        bool listo;
+        if (e == ETAPA_CAPTURA)
+            listo = !sinCaptura && siguiente[ETAPA_CAPTURA] - siguiente[ETAPA_PRESENTACION] < (uint64)nRanuras;
+        else
+            listo = siguiente[e] < siguiente[e - 1];
+        if (!listo)
+            continue;
+        ocupada[e] = true;
+        uint64 numero = siguiente[e];
+        planificador.lanzar([this, e, numero] { ejecutar(e, numero); });
+    }
+
+    if (sinCaptura && !ocupada[ETAPA_CAPTURA] && !ocupada[ETAPA_SEGMENTACION] && !ocupada[ETAPA_PRESENTACION]
+            && siguiente[ETAPA_PRESENTACION] == siguiente[ETAPA_CAPTURA])
+    {
+        activo = false;
+        terminado.notify_all();
+    }
+}
+
+/** Tarea de una etapa sobre un frame; al terminar lanza lo que haya quedado listo
+ * @brief EjecutorFrames::ejecutar
+ */
+void EjecutorFrames::ejecutar(int etapa, uint64 numero)
+{
+    int ranura = (int)(numero % nRanuras);
+    uint64_t t0 = Instrumentacion::ahoraNs();
+    bool hayFrame = true;
+    if (etapa == ETAPA_CAPTURA)
+        hayFrame = capturar(ranura, numero);
+    else if (etapa == ETAPA_SEGMENTACION)
+        segmentar(ranura, numero);
+    else
+        presentar(ranura, numero);
+    uint64_t t1 = Instrumentacion::ahoraNs();
+
+    std::lock_guard<std::mutex> l(m);
+    ocupada[etapa] = false;
+    if (!hayFrame)
+        sinCaptura = true;
+    else
+    {
+        nsEtapa[etapa] += t1 - t0;
+        siguiente[etapa]++;
+    }
+    if (etapa == ETAPA_CAPTURA && hayFrame)
+    {
+        inicioFrame[ranura] = t0;
+        maxEnVuelo = std::max(maxEnVuelo, (int)(siguiente[ETAPA_CAPTURA] - siguiente[ETAPA_PRESENTACION]));
+    }
+    else if (etapa == ETAPA_PRESENTACION)
+    {
+        double ms = (t1 - inicioFrame[ranura]) * 1e-6;
+        if (latencias.size() < (size_t)VENTANA)
+            latencias.push_back(ms);
+        else
+            latencias[numero % VENTANA] = ms;
+        sumaLatencias += ms;
+        maxLatencia = std::max(maxLatencia, ms);
+        nsUltimo = t1;
+    }
+    despachar();
+}
+
+void EjecutorFrames::resumen(Resumen &r) const
+{
+    std::lock_guard<std::mutex> l(m);
+    r = Resumen();
+    r.frames = siguiente[ETAPA_PRESENTACION];
+    r.segundos = (nsUltimo - nsInicio) * 1e-9;
+    r.fps = r.segundos > 0 ? r.frames / r.segundos : 0;
+    for (int e = 0; e < NUM_ETAPAS; e++)
+        if (siguiente[e] > 0)
+            r.msEtapa[e] = nsEtapa[e] * 1e-6 / siguiente[e];
+    r.maxEnVuelo = maxEnVuelo;
+    if (r.frames == 0)
+        return;
+    r.latenciaMediaMs = sumaLatencias / r.frames;
+    r.latenciaMaxMs = maxLatencia;
+    std::vector<double> muestras(latencias);
+    std::sort(muestras.begin(), muestras.end());
+    size_t n = muestras.size();
+    r.latenciaP50Ms = muestras[n / 2];
+    r.latenciaP99Ms = muestras[std::min(n - 1, (size_t)(0.99 * n))];
+}
@@ -0,0 +1,112 @@
+#ifndef EJECUTOR_H
+#define EJECUTOR_H
+
+#include <opencv2/core/core.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "planificador.h"
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ * Pipeline de frames en tres etapas (captura, segmentacion y presentacion) planificadas como
+ * tareas en un PlanificadorTareas. Cada etapa procesa los frames de uno en uno y en orden,
+ * pero etapas distintas trabajan a la vez sobre frames distintos: mientras se captura el
+ * frame N se segmenta el N-1 y se presenta el N-2. Asi el ritmo lo marca la etapa mas lenta
+ * y no la suma de todas.
+ *
+ * Los frames en vuelo estan acotados por el numero de ranuras: el frame k usa la ranura
+ * k % nRanuras, que queda libre cuando el frame k - nRanuras se ha presentado. El dueno
+ * reserva sus buffers por ranura y las funciones de etapa solo tocan los de la suya.
+ */
+
+using namespace cv;
+
+class EjecutorFrames
+{
+public:
+    enum Etapa{
+        ETAPA_CAPTURA,
+        ETAPA_SEGMENTACION,
+        ETAPA_PRESENTACION,
+        NUM_ETAPAS
+    };
+
+    //Rellena la ranura con el frame numero; false si no hay mas frames
+    typedef std::function<bool(int ranura, uint64 numero)> FuncionCaptura;
+    typedef std::function<void(int ranura, uint64 numero)> FuncionEtapa;
+
+    static const int VENTANA = 128;     //latencias recientes para los percentiles
+
+    struct Resumen{
+        uint64 frames;              //presentados
+        double segundos;            //desde iniciar hasta la ultima presentacion
+        double fps;
+        double msEtapa[NUM_ETAPAS]; //tiempo ocupado medio por frame de cada etapa
+        double latenciaMediaMs;     //de empezar la captura a terminar la presentacion
+        double latenciaP50Ms, latenciaP99Ms, latenciaMaxMs;
+        int maxEnVuelo;             //frames capturados y sin presentar a la vez
+
+        Resumen() : frames(0), segundos(0), fps(0), latenciaMediaMs(0), latenciaP50Ms(0), latenciaP99Ms(0),
+            latenciaMaxMs(0), maxEnVuelo(0)
+        {
+            for (int e = 0; e < NUM_ETAPAS; e++)
+                msEtapa[e] = 0;
+        }
+    };
+
+    EjecutorFrames(PlanificadorTareas &planificador, int nRanuras = 3);
+
+    //Detiene la captura y espera a los frames en vuelo
+    ~EjecutorFrames();
+
+    int numRanuras() const { return nRanuras; }
+
+    /** Empieza a capturar frames; vuelve enseguida. No se puede llamar con el pipeline en marcha. */
+    void iniciar(const FuncionCaptura &capturar, const FuncionEtapa &segmentar, const FuncionEtapa &presentar);
+
+    //No empieza mas capturas y espera a que se presenten los frames ya capturados
+    void detener();
+
+    //Espera a que la captura se acabe (devuelva false) y se presenten todos los frames
+    void esperar();
+
+    bool enMarcha() const;
+
+    void resumen(Resumen &r) const;
+
+private:
+    PlanificadorTareas &planificador;
+    int nRanuras;
+    FuncionCaptura capturar;
+    FuncionEtapa segmentar, presentar;
+
+    mutable std::mutex m;
+    std::condition_variable terminado;
+    bool activo;                        //entre iniciar y el fin del ultimo frame
+    bool sinCaptura;                    //la captura se ha acabado o se ha detenido
+    bool ocupada[NUM_ETAPAS];
+    uint64 siguiente[NUM_ETAPAS];       //siguiente frame de cada etapa
+    std::vector<uint64_t> inicioFrame;  //por ranura, para la latencia
+
+    uint64_t nsInicio, nsUltimo;
+    uint64_t nsEtapa[NUM_ETAPAS];
+    int maxEnVuelo;
+    std::vector<double> latencias;      //ventana circular, ms
+    double sumaLatencias, maxLatencia;
+
+    void despachar();
+    void ejecutar(int etapa, uint64 numero);
+
+    EjecutorFrames(const EjecutorFrames &);
+    EjecutorFrames &operator=(const EjecutorFrames &);
+};
+
+#endif // EJECUTOR_H
@@ -0,0 +1,57 @@
+#include "espaciotrabajo.h"
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ *
+ */
+
+EspacioTrabajo::EspacioTrabajo() : capacidad(0), reservas(0)
+{
+}
+
+bool EspacioTrabajo::reservar(Mat &m, Size tam, int tipo)
+{
+    if (m.size() == tam && m.type() == tipo && m.isContinuous())
+        return false;
+    m.create(tam, tipo);
+    reservas++;
+    return true;
+}
+
+void EspacioTrabajo::reservarBordes(Size tam)
+{
+    //Canny escribe directamente en la vista y floodFill recibe la mascara sin copiar los bordes.
+    //El marco no se inicializa: cv::floodFill lo pone a 1 en cada llamada
+    reservar(imgMask, Size(tam.width + 2, tam.height + 2), CV_8UC1);
+    detected_edges = imgMask(Rect(1, 1, tam.width, tam.height));
+}
+
+void EspacioTrabajo::reservarEtiquetas(Size tam, bool cortas)
+{
+    Mat &m = cortas ? etiquetas16 : etiquetas32;
+    reservar(m, tam, cortas ? CV_16SC1 : CV_32SC1);
+    imgRegiones = m;
+}
+
+void EspacioTrabajo::promoverEtiquetas()
+{
+    if (imgRegiones.type() == CV_32SC1)
+        return;
+    reservar(etiquetas32, imgRegiones.size(), CV_32SC1);
+    imgRegiones.convertTo(etiquetas32, CV_32S);
+    imgRegiones = etiquetas32;
+}
+
+void EspacioTrabajo::finFrame(size_t otras)
+{
+    size_t total = listRegiones.capacidad() + fronteras.inicio.capacity()
+            + fronteras.puntos.capacity() + otras;
+    if (total > capacidad)
+    {
+        reservas++;
+        capacidad = total;
+    }
+}
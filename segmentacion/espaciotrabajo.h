@@ -0,0 +1,71 @@
+#ifndef ESPACIOTRABAJO_H
+#define ESPACIOTRABAJO_H
+
+#include <opencv2/core/core.hpp>
+
+#include <vector>
+
+#include "region.h"
+#include "frontera.h"
+#include "etiquetas.h"
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ * Buffers de un frame que se reutilizan de un frame al siguiente. Las imagenes solo se
+ * reservan cuando cambia su tamano o tipo (las etiquetas de 16 y 32 bits tienen cada una su
+ * buffer) y la lista de regiones y las fronteras conservan su capacidad.
+ * El contador suma una reserva por cada imagen reservada de nuevo y una por cada frame en el
+ * que la lista de regiones, las fronteras o los vectores auxiliares del Segmentador han tenido
+ * que crecer. No cuenta lo que reserva OpenCV por dentro (floodFill en cada llamada, Canny,
+ * blur, sepFilter2D) ni las tareas de PlanificadorTareas::paraCada; bench -a mide todo.
+ */
+
+using namespace cv;
+
+class EspacioTrabajo
+{
+public:
+    EspacioTrabajo();
+
+    Mat suavizada;          //Entrada suavizada para Canny (mismo tipo que la entrada)
+    Mat gradX, gradY;       //Con suavizado fusionado: derivadas de la entrada suavizada (CV_16S)
+    Mat cannyZona;          //Modo incremental: Canny de la zona cambiada antes de copiar sus bloques
+    Mat imgMask;            //Mascara de floodFill, con un pixel de borde alrededor de detected_edges
+    Mat detected_edges;     //Bordes que no se etiquetan (CV_8UC1, 255): vista del interior de imgMask
+    Mat imgRegiones;        //Etiqueta de cada pixel (CV_16SC1 o CV_32SC1, ver etiquetas.h); es uno de los dos buffers de abajo
+    TablaRegiones listRegiones;
+    Fronteras fronteras;    //Puntos frontera de todas las regiones (CSR)
+
+    /** Deja m con el tamano y tipo pedidos; solo reserva si no los tenia
+     * @return true si ha habido que reservar
+     */
+    bool reservar(Mat &m, Size tam, int tipo);
+
+    //Reserva imgMask para una imagen de tamano tam y deja detected_edges apuntando a su interior
+    void reservarBordes(Size tam);
+
+    //Deja imgRegiones apuntando al buffer de 16 o 32 bits, reservandolo si hace falta
+    void reservarEtiquetas(Size tam, bool cortas);
+
+    //Pasa imgRegiones a 32 bits conservando las etiquetas
+    void promoverEtiquetas();
+
+    /** Cuenta como reserva el crecimiento de la lista de regiones o de las fronteras
+     * @param otras capacidad de buffers auxiliares de fuera del espacio (p.ej. ExtractorFrontera)
+     */
+    void finFrame(size_t otras = 0);
+
+    uint64 getReservas() const { return reservas; }
+    void resetReservas() { reservas = 0; }
+
+private:
+    //Los dos anchos de etiqueta se conservan, asi que cambiar de uno a otro entre frames no reserva
+    Mat etiquetas16, etiquetas32;
+    size_t capacidad;       //Capacidad total en el ultimo finFrame
+    uint64 reservas;
+};
+
+#endif // ESPACIOTRABAJO_H
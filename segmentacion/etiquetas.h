@@ -0,0 +1,50 @@
+#ifndef ETIQUETAS_H
+#define ETIQUETAS_H
+
+#include <opencv2/core/core.hpp>
+
+#include <climits>
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ * Ancho de la imagen de etiquetas (imgRegiones). Con los umbrales habituales un frame tiene
+ * muy pocas regiones en comparacion con los pixeles, asi que las etiquetas caben en 16 bits y
+ * las pasadas sobre la imagen completa (etiquetado, bordes, fronteras, fusion, pintado) mueven
+ * la mitad de memoria. Si un frame no cabe se promueve a 32 bits. Las etiquetas llevan signo
+ * por el -1 de los pixeles sin region y las marcas -2 - id de AsignadorBordes, asi que en
+ * 16 bits caben 32767 regiones (ids 0 .. 32766).
+ *
+ * Las etapas estan escritas como plantillas sobre el tipo de etiqueta (short o int) y eligen
+ * la instancia con el tipo de imgRegiones, que es CV_16SC1 o CV_32SC1.
+ */
+
+using namespace cv;
+
+template<typename T> struct Etiquetas;
+
+template<> struct Etiquetas<short>{
+    static const int TIPO = CV_16SC1;
+    static const int MAX_REGIONES = SHRT_MAX;
+};
+
+template<> struct Etiquetas<int>{
+    static const int TIPO = CV_32SC1;
+    static const int MAX_REGIONES = INT_MAX;
+};
+
+//imgRegiones esta en 16 bits
+inline bool etiquetasCortas(const Mat &imgRegiones)
+{
+    return imgRegiones.type() == CV_16SC1;
+}
+
+//Tipo de una imagen de etiquetas nueva: se conserva el de imgRegiones y por defecto 32 bits
+inline int tipoEtiquetas(const Mat &imgRegiones)
+{
+    return etiquetasCortas(imgRegiones) ? CV_16SC1 : CV_32SC1;
+}
+
+#endif // ETIQUETAS_H
@@ -0,0 +1,170 @@
+#include "frontera.h"
+
+#include <opencv2/core/hal/intrin.hpp>
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ *
+ */
+
+/** Comprobacion escalar con limites, para las filas y columnas del borde de la imagen
+ * @brief esFrontera
+ */
+template<typename T>
+static inline bool esFrontera(const Mat &imgRegiones, int y, int x)
+{
+    T id = imgRegiones.ptr<T>(y)[x];
+    for (int dy = -1; dy <= 1; dy++)
+    {
+        int yy = y + dy;
+        if (yy < 0 || yy >= imgRegiones.rows)
+            continue;
+        const T *fila = imgRegiones.ptr<T>(yy);
+        for (int dx = -1; dx <= 1; dx++)
+        {
+            int xx = x + dx;
+            if (xx < 0 || xx >= imgRegiones.cols)
+                continue;
+            if (fila[xx] != id)
+                return true;
+        }
+    }
+    return false;
+}
+
+#if CV_SIMD128
+/** Compara la fila con sus 8 desplazamientos por bloques del ancho del registro desde x; los
+ * bloques sin ninguna diferencia (el interior de las regiones) se descartan con una sola
+ * comprobacion. Devuelve la primera columna que queda por revisar.
+ * @brief bloquesFrontera
+ */
+static inline int bloquesFrontera(const int *arriba, const int *fila, const int *abajo, int x, int cols, int base,
+                                  std::vector<int> &indices)
+{
+    const int ancho = v_int32x4::nlanes;
+    int distinto[ancho];
+    for (; x + ancho < cols; x += ancho)
+    {
+        v_int32x4 c = v_load(fila + x);
+        v_int32x4 d = (c != v_load(fila + x - 1)) | (c != v_load(fila + x + 1))
+                | (c != v_load(arriba + x - 1)) | (c != v_load(arriba + x)) | (c != v_load(arriba + x + 1))
+                | (c != v_load(abajo + x - 1)) | (c != v_load(abajo + x)) | (c != v_load(abajo + x + 1));
+        if (!v_check_any(d))
+            continue;
+        v_store(distinto, d);
+        for (int k = 0; k < ancho; k++)
+            if (distinto[k])
+                indices.push_back(base + x + k);
+    }
+    return x;
+}
+
+//Con etiquetas de 16 bits cada registro compara el doble de pixeles
+static inline int bloquesFrontera(const short *arriba, const short *fila, const short *abajo, int x, int cols,
+                                  int base, std::vector<int> &indices)
+{
+    const int ancho = v_int16x8::nlanes;
+    short distinto[ancho];
+    for (; x + ancho < cols; x += ancho)
+    {
+        v_int16x8 c = v_load(fila + x);
+        v_int16x8 d = (c != v_load(fila + x - 1)) | (c != v_load(fila + x + 1))
+                | (c != v_load(arriba + x - 1)) | (c != v_load(arriba + x)) | (c != v_load(arriba + x + 1))
+                | (c != v_load(abajo + x - 1)) | (c != v_load(abajo + x)) | (c != v_load(abajo + x + 1));
+        if (!v_check_any(d))
+            continue;
+        v_store(distinto, d);
+        for (int k = 0; k < ancho; k++)
+            if (distinto[k])
+                indices.push_back(base + x + k);
+    }
+    return x;
+}
+#endif
+
+void ExtractorFrontera::extraer(const Mat &imgRegiones, int nRegiones, Fronteras &fronteras)
+{
+    CV_Assert((imgRegiones.type() == CV_16SC1 || imgRegiones.type() == CV_32SC1) && imgRegiones.isContinuous());
+    if (etiquetasCortas(imgRegiones))
+        extraerT<short>(imgRegiones, nRegiones, fronteras);
+    else
+        extraerT<int>(imgRegiones, nRegiones, fronteras);
+}
+
+template<typename T>
+void ExtractorFrontera::extraerT(const Mat &imgRegiones, int nRegiones, Fronteras &fronteras)
+{
+    //Primera pasada: indices de los pixeles frontera en orden de barrido
+    indices.clear();
+    for (int y = 0; y < imgRegiones.rows; y++)
+    {
+        if (y == 0 || y == imgRegiones.rows - 1)
+            filaBorde<T>(imgRegiones, y);
+        else
+            filaInterior<T>(imgRegiones, y);
+    }
+
+    //Desplazamientos por region (recuento + suma acumulada)
+    const T *etiquetas = imgRegiones.ptr<T>(0);
+    fronteras.inicio.assign(nRegiones + 1, 0);
+    for (size_t i = 0; i < indices.size(); i++)
+        if (etiquetas[indices[i]] >= 0)
+            fronteras.inicio[etiquetas[indices[i]] + 1]++;
+    for (int id = 0; id < nRegiones; id++)
+        fronteras.inicio[id + 1] += fronteras.inicio[id];
+
+    //Segunda pasada, solo sobre los puntos frontera: cada uno a su tramo, manteniendo el orden
+    cursor.assign(fronteras.inicio.begin(), fronteras.inicio.end() - 1);
+    fronteras.puntos.resize(fronteras.inicio[nRegiones]);
+    int cols = imgRegiones.cols;
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        int idx = indices[i];
+        if (etiquetas[idx] >= 0)
+            fronteras.puntos[cursor[etiquetas[idx]]++] = Point(idx % cols, idx / cols);
+    }
+}
+
+template<typename T>
+void ExtractorFrontera::filaBorde(const Mat &imgRegiones, int y)
+{
+    int base = y * imgRegiones.cols;
+    for (int x = 0; x < imgRegiones.cols; x++)
+        if (esFrontera<T>(imgRegiones, y, x))
+            indices.push_back(base + x);
+}
+
+/** Fila con vecinos arriba y abajo: por bloques SIMD (bloquesFrontera) y el resto escalar
+ * @brief ExtractorFrontera::filaInterior
+ */
+template<typename T>
+void ExtractorFrontera::filaInterior(const Mat &imgRegiones, int y)
+{
+    const T *arriba = imgRegiones.ptr<T>(y - 1);
+    const T *fila = imgRegiones.ptr<T>(y);
+    const T *abajo = imgRegiones.ptr<T>(y + 1);
+    int cols = imgRegiones.cols;
+    int base = y * cols;
+
+    if (esFrontera<T>(imgRegiones, y, 0))
+        indices.push_back(base);
+
+    int x = 1;
+#if CV_SIMD128
+    x = bloquesFrontera(arriba, fila, abajo, x, cols, base, indices);
+#endif
+    for (; x < cols - 1; x++)
+    {
+        T c = fila[x];
+        if (c != fila[x - 1] || c != fila[x + 1]
+                || c != arriba[x - 1] || c != arriba[x] || c != arriba[x + 1]
+                || c != abajo[x - 1] || c != abajo[x] || c != abajo[x + 1])
+            indices.push_back(base + x);
+    }
+
+    if (cols > 1 && esFrontera<T>(imgRegiones, y, cols - 1))
+        indices.push_back(base + cols - 1);
+}
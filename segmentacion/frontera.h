@@ -0,0 +1,52 @@
+#ifndef FRONTERA_H
+#define FRONTERA_H
+
+#include <opencv2/core/core.hpp>
+
+#include <vector>
+
+#include "etiquetas.h"
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ * Puntos frontera de todas las regiones en un unico buffer (formato CSR): los de la region id
+ * son puntos[inicio[id]] .. puntos[inicio[id + 1] - 1], en orden de barrido.
+ * Un pixel es frontera si alguno de sus 8 vecinos dentro de la imagen tiene otra etiqueta.
+ */
+
+using namespace cv;
+
+struct Fronteras
+{
+    std::vector<int> inicio;        //nRegiones + 1 desplazamientos
+    std::vector<Point> puntos;      //Point(columna, fila)
+
+    int numRegiones() const { return inicio.empty() ? 0 : (int)inicio.size() - 1; }
+    int tamano(int id) const { return inicio[id + 1] - inicio[id]; }
+    const Point *de(int id) const { return puntos.data() + inicio[id]; }
+};
+
+class ExtractorFrontera
+{
+public:
+    /** Extrae las fronteras de una imagen de etiquetas
+     * @param imgRegiones etiquetas CV_16SC1 o CV_32SC1 en [0, nRegiones); los pixeles a -1 no se emiten
+     */
+    void extraer(const Mat &imgRegiones, int nRegiones, Fronteras &fronteras);
+
+    //Capacidad reservada por los buffers auxiliares, para el contador de EspacioTrabajo
+    size_t capacidad() const { return indices.capacity() + cursor.capacity(); }
+
+private:
+    std::vector<int> indices;       //Indice de pixel de cada punto frontera, en orden de barrido
+    std::vector<int> cursor;        //Siguiente posicion libre de cada region al repartir
+
+    template<typename T> void extraerT(const Mat &imgRegiones, int nRegiones, Fronteras &fronteras);
+    template<typename T> void filaBorde(const Mat &imgRegiones, int y);
+    template<typename T> void filaInterior(const Mat &imgRegiones, int y);
+};
+
+#endif // FRONTERA_H
@@ -0,0 +1,351 @@
+#include "fusion.h"
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ *
+ */
+
+int FusionRegiones::fusionar(Mat &imgRegiones, TablaRegiones &listRegiones, bool color, float umbral)
+{
+    CV_Assert(imgRegiones.type() == CV_16SC1 || imgRegiones.type() == CV_32SC1);
+
+    int n = (int)listRegiones.size();
+    if (n < 2)
+        return 0;
+
+    cn = color ? 3 : 1;
+    padre.resize(n);
+    fusionada.assign(n, 0);
+    nPuntos.resize(n);
+    sumas.resize(n * cn);
+    medias.resize(n * cn);
+    for (int i = 0; i < n; i++)
+    {
+        padre[i] = i;
+        nPuntos[i] = listRegiones.nPuntos[i];
+        for (int c = 0; c < cn; c++)
+        {
+            sumas[i * cn + c] = listRegiones.suma[i][c];
+            medias[i * cn + c] = nPuntos[i] > 0 ? sumas[i * cn + c] / nPuntos[i] : 0;
+        }
+    }
+
+    bool cortas = etiquetasCortas(imgRegiones);
+    if (cortas)
+        construirGrafo<short>(imgRegiones, n, umbral);
+    else
+        construirGrafo<int>(imgRegiones, n, umbral);
+
+    //Cada arista del monticulo une dos raices distintas con su diferencia actual
+    int fusiones = 0;
+    while (!monticulo.empty())
+    {
+        int e = sacarMinimo();
+        unir(extremo[2 * e + 1], extremo[2 * e], umbral);
+        fusiones++;
+    }
+
+    if (fusiones > 0)
+    {
+        if (cortas)
+            reetiquetar<short>(imgRegiones, listRegiones);
+        else
+            reetiquetar<int>(imgRegiones, listRegiones);
+    }
+    return fusiones;
+}
+
+size_t FusionRegiones::capacidad() const
+{
+    return pares.capacity() + extremo.capacity() + siguiente.capacity() + cabeza.capacity() + cola.capacity()
+            + viva.capacity() + marca.capacity() + monticulo.capacity() + posicion.capacity() + clave.capacity()
+            + padre.capacity() + fusionada.capacity() + nPuntos.capacity() + sumas.capacity() + medias.capacity()
+            + nuevoId.capacity();
+}
+
+double FusionRegiones::diferencia(int a, int b) const
+{
+    double d = 0;
+    for (int c = 0; c < cn; c++)
+        d = std::max(d, std::fabs(medias[a * cn + c] - medias[b * cn + c]));
+    return d;
+}
+
+/** Aristas entre regiones 4-adyacentes, listas de adyacencia y monticulo inicial
+ * @brief FusionRegiones::construirGrafo
+ */
+template<typename T>
+void FusionRegiones::construirGrafo(const Mat &imgRegiones, int nRegiones, float umbral)
+{
+    pares.clear();
+    for (int y = 0; y < imgRegiones.rows; y++)
+    {
+        const T *fila = imgRegiones.ptr<T>(y);
+        const T *abajo = y + 1 < imgRegiones.rows ? imgRegiones.ptr<T>(y + 1) : NULL;
+        for (int x = 0; x < imgRegiones.cols; x++)
+        {
+            int l = fila[x];
+            if (l < 0)
+                continue;
+            int vecino[2] = { x + 1 < imgRegiones.cols ? fila[x + 1] : -1, abajo ? abajo[x] : -1 };
+            for (int k = 0; k < 2; k++)
+            {
+                int v = vecino[k];
+                if (v < 0 || v == l)
+                    continue;
+                uint64 par = ((uint64)std::min(l, v) << 32) | (uint64)std::max(l, v);
+                //A lo largo de una frontera se repite la misma arista muchas veces seguidas
+                if (pares.empty() || pares.back() != par)
+                    pares.push_back(par);
+            }
+        }
+    }
+    std::sort(pares.begin(), pares.end());
+    pares.erase(std::unique(pares.begin(), pares.end()), pares.end());
+
+    int nAristas = (int)pares.size();
+    extremo.resize(2 * nAristas);
+    siguiente.resize(2 * nAristas);
+    viva.assign(nAristas, 1);
+    posicion.assign(nAristas, -1);
+    clave.resize(nAristas);
+    cabeza.assign(nRegiones, -1);
+    cola.assign(nRegiones, -1);
+    marca.assign(nRegiones, 0);
+    sello = 0;
+    monticulo.clear();
+
+    for (int k = 0; k < nAristas; k++)
+    {
+        int a = (int)(pares[k] >> 32);
+        int b = (int)(pares[k] & 0xFFFFFFFF);
+        int desde[2] = { a, b };
+        int hasta[2] = { b, a };
+        for (int s = 0; s < 2; s++)
+        {
+            int h = 2 * k + s;
+            extremo[h] = hasta[s];
+            siguiente[h] = -1;
+            if (cola[desde[s]] == -1)
+                cabeza[desde[s]] = h;
+            else
+                siguiente[cola[desde[s]]] = h;
+            cola[desde[s]] = h;
+        }
+
+        clave[k] = diferencia(a, b);
+        if (clave[k] <= umbral)
+        {
+            posicion[k] = (int)monticulo.size();
+            monticulo.push_back(k);
+        }
+    }
+    for (int i = (int)monticulo.size() / 2 - 1; i >= 0; i--)
+        bajar(i);
+}
+
+//Orden del monticulo: menor diferencia y, a igualdad, menor id de arista
+bool FusionRegiones::antes(int e, int f) const
+{
+    return clave[e] < clave[f] || (clave[e] == clave[f] && e < f);
+}
+
+void FusionRegiones::subir(int i)
+{
+    int e = monticulo[i];
+    while (i > 0)
+    {
+        int p = (i - 1) / 2;
+        if (!antes(e, monticulo[p]))
+            break;
+        monticulo[i] = monticulo[p];
+        posicion[monticulo[i]] = i;
+        i = p;
+    }
+    monticulo[i] = e;
+    posicion[e] = i;
+}
+
+void FusionRegiones::bajar(int i)
+{
+    int n = (int)monticulo.size();
+    int e = monticulo[i];
+    while (true)
+    {
+        int h = 2 * i + 1;
+        if (h >= n)
+            break;
+        if (h + 1 < n && antes(monticulo[h + 1], monticulo[h]))
+            h++;
+        if (!antes(monticulo[h], e))
+            break;
+        monticulo[i] = monticulo[h];
+        posicion[monticulo[i]] = i;
+        i = h;
+    }
+    monticulo[i] = e;
+    posicion[e] = i;
+}
+
+/** Nueva clave de la arista e: entra, se recoloca o sale del monticulo segun el umbral.
+ * Con d < 0 la arista sale siempre (interna o repetida).
+ * @brief FusionRegiones::actualizar
+ */
+void FusionRegiones::actualizar(int e, double d, float umbral)
+{
+    int i = posicion[e];
+    if (d < 0 || d > umbral)
+    {
+        if (i == -1)
+            return;
+        int ultima = monticulo.back();
+        monticulo.pop_back();
+        posicion[e] = -1;
+        if (ultima == e)
+            return;
+        monticulo[i] = ultima;
+        posicion[ultima] = i;
+        subir(i);
+        bajar(posicion[ultima]);
+        return;
+    }
+    bool menor = d < clave[e];
+    clave[e] = d;
+    if (i == -1)
+    {
+        monticulo.push_back(e);
+        subir((int)monticulo.size() - 1);
+    }
+    else if (menor)
+        subir(i);
+    else
+        bajar(i);
+}
+
+int FusionRegiones::sacarMinimo()
+{
+    int e = monticulo[0];
+    actualizar(e, -1, 0);
+    return e;
+}
+
+/** Fusiona dos raices: empalma sus listas de adyacencia y recorre la resultante quitando la
+ * arista entre ambas y las repetidas y actualizando la clave de las demas con la nueva media
+ * @brief FusionRegiones::unir
+ */
+void FusionRegiones::unir(int a, int b, float umbral)
+{
+    //La raiz es el menor id, asi la region conserva la semilla que aparece antes en el barrido
+    int r = std::min(a, b);
+    int o = std::max(a, b);
+
+    nPuntos[r] += nPuntos[o];
+    for (int c = 0; c < cn; c++)
+    {
+        sumas[r * cn + c] += sumas[o * cn + c];
+        medias[r * cn + c] = sumas[r * cn + c] / nPuntos[r];
+    }
+    padre[o] = r;
+    fusionada[r] = 1;
+
+    if (cabeza[o] != -1)
+    {
+        if (cabeza[r] == -1)
+            cabeza[r] = cabeza[o];
+        else
+            siguiente[cola[r]] = cabeza[o];
+        cola[r] = cola[o];
+    }
+    cabeza[o] = cola[o] = -1;
+
+    int anterior = -1;
+    sello++;
+    for (int h = cabeza[r]; h != -1; h = siguiente[h])
+    {
+        int e = h >> 1;
+        //Los extremos de las aristas vivas son siempre raices; solo las de o han dejado de serlo
+        int t = viva[e] ? extremo[h] : r;
+        if (t == o)
+            t = r;
+        if (t == r || marca[t] == sello)
+        {
+            //Las semiaristas de e en otras listas se descartan cuando se recorran
+            if (viva[e])
+            {
+                viva[e] = 0;
+                actualizar(e, -1, umbral);
+            }
+            if (anterior == -1)
+                cabeza[r] = siguiente[h];
+            else
+                siguiente[anterior] = siguiente[h];
+            continue;
+        }
+        marca[t] = sello;
+        extremo[h] = t;
+        extremo[h ^ 1] = r;
+        anterior = h;
+        actualizar(e, diferencia(r, t), umbral);
+    }
+    cola[r] = anterior;
+}
+
+/** Compacta ids y estadisticas de las regiones fusionadas y reetiqueta la imagen en una pasada
+ * @brief FusionRegiones::reetiquetar
+ */
+template<typename T>
+void FusionRegiones::reetiquetar(Mat &imgRegiones, TablaRegiones &listRegiones)
+{
+    int n = (int)listRegiones.size();
+
+    nuevoId.resize(n);
+    int k = 0;
+    for (int i = 0; i < n; i++)
+    {
+        int raiz = buscar(i);
+        if (raiz == i)
+        {
+            nuevoId[i] = k++;
+            continue;
+        }
+        //La raiz tiene menor id, asi que ya tiene su nuevo id y sigue en su posicion
+        nuevoId[i] = nuevoId[raiz];
+        listRegiones.nPuntos[raiz] += listRegiones.nPuntos[i];
+        listRegiones.suma[raiz] += listRegiones.suma[i];
+        listRegiones.sumaCuadrados[raiz] += listRegiones.sumaCuadrados[i];
+        listRegiones.caja[raiz] |= listRegiones.caja[i];
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        if (padre[i] != i)
+            continue;
+        int dst = nuevoId[i];
+        if (dst != i)
+            listRegiones.copiar(dst, i);
+        if (!fusionada[i])
+            continue;
+        if (cn == 3)
+        {
+            for (int c = 0; c < 3; c++)
+                listRegiones.rgbMedio[dst][c] = (uchar)medias[i * 3 + c];
+        }
+        else
+            listRegiones.gMedio[dst] = (uchar)medias[i];
+    }
+    listRegiones.resize(k);
+
+    for (int y = 0; y < imgRegiones.rows; y++)
+    {
+        T *fila = imgRegiones.ptr<T>(y);
+        for (int x = 0; x < imgRegiones.cols; x++)
+            if (fila[x] >= 0)
+                fila[x] = (T)nuevoId[fila[x]];
+    }
+}
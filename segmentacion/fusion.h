@@ -0,0 +1,84 @@
+#ifndef FUSION_H
+#define FUSION_H
+
+#include <opencv2/core/core.hpp>
+
+#include <vector>
+
+#include "region.h"
+#include "etiquetas.h"
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ * Fusion de regiones sobre el grafo de adyacencia (4-vecindad) de la imagen de etiquetas.
+ * Se fusiona siempre el par adyacente mas parecido mientras la diferencia de medias (gris, o
+ * maxima por canal en color, a partir de suma / nPuntos) no supere el umbral. Cada par de
+ * raices es una arista de un monticulo indexado; al fusionar se recorren las aristas de la
+ * region resultante, quitando las repetidas y actualizando su clave en O(log E) cada una.
+ */
+
+using namespace cv;
+
+class FusionRegiones
+{
+public:
+    /** Fusiona regiones adyacentes y actualiza imgRegiones y listRegiones
+     * @param umbral diferencia maxima de medias para fusionar dos regiones
+     * @return numero de fusiones realizadas
+     */
+    int fusionar(Mat &imgRegiones, TablaRegiones &listRegiones, bool color, float umbral);
+
+    //Capacidad reservada por los buffers auxiliares, para el contador de EspacioTrabajo
+    size_t capacidad() const;
+
+private:
+    std::vector<uint64> pares;      //Aristas (idMenor << 32 | idMayor), ordenadas y sin repetir
+
+    //Listas de adyacencia enlazadas, que se concatenan en O(1) al fusionar; la arista e tiene
+    //las semiaristas 2e y 2e+1
+    std::vector<int> extremo;       //Region al otro lado de cada semiarista
+    std::vector<int> siguiente;     //Siguiente semiarista de la misma lista, -1 al final
+    std::vector<int> cabeza, cola;  //Primera y ultima semiarista de cada region
+    std::vector<uchar> viva;        //La arista no se ha quitado por interna o repetida
+    std::vector<int> marca;         //Para quitar repetidos al recorrer una lista
+    int sello;                      //Valor de marca del recorrido actual
+
+    //Monticulo indexado de aristas por debajo del umbral, de menor a mayor diferencia
+    std::vector<int> monticulo;     //Ids de arista
+    std::vector<int> posicion;      //Posicion de cada arista en el monticulo, -1 si no esta
+    std::vector<double> clave;      //Diferencia de medias de cada arista
+
+    std::vector<int> padre;         //Union-find de regiones, raiz = menor id
+    std::vector<uchar> fusionada;   //La raiz ha absorbido alguna region
+    std::vector<int> nPuntos;
+    std::vector<double> sumas;      //Suma por canal de cada raiz (cn valores por region)
+    std::vector<double> medias;     //sumas / nPuntos
+    std::vector<int> nuevoId;
+
+    int cn;
+
+    inline int buscar(int i)
+    {
+        while (padre[i] != i)
+        {
+            padre[i] = padre[padre[i]];
+            i = padre[i];
+        }
+        return i;
+    }
+
+    double diferencia(int a, int b) const;
+    template<typename T> void construirGrafo(const Mat &imgRegiones, int nRegiones, float umbral);
+    bool antes(int e, int f) const;
+    void subir(int i);
+    void bajar(int i);
+    void actualizar(int e, double d, float umbral);
+    int sacarMinimo();
+    void unir(int a, int b, float umbral);
+    template<typename T> void reetiquetar(Mat &imgRegiones, TablaRegiones &listRegiones);
+};
+
+#endif // FUSION_H
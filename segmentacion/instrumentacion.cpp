@@ -0,0 +1,209 @@
+#include "instrumentacion.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ *
+ */
+
+namespace {
+
+//Un escritor por contador: load + store relajados bastan, no hace falta fetch_add
+struct Contador{
+    std::atomic<uint64_t> n;
+    std::atomic<uint64_t> totalNs;
+    std::atomic<uint32_t> ventana[Instrumentacion::VENTANA];   //ns, saturado a 2^32-1
+};
+
+//Alineado a linea de cache para que dos hilos no compartan lineas al escribir
+struct alignas(64) Hueco{
+    std::atomic<bool> ocupado;
+    Contador medidas[Instrumentacion::NUM_MEDIDAS];
+};
+
+//Almacenamiento estatico: los atomicos empiezan a cero
+Hueco huecos[Instrumentacion::MAX_HILOS];
+std::atomic<uint64_t> nPerdidas;
+
+//Al terminar el hilo el hueco queda libre para otro, con sus contadores intactos
+struct Propietario{
+    Hueco *hueco;
+    Propietario() : hueco(NULL) {}
+    ~Propietario()
+    {
+        if (hueco != NULL)
+            hueco->ocupado.store(false, std::memory_order_release);
+    }
+};
+
+thread_local Propietario propietario;
+thread_local bool sinHueco = false;
+
+Hueco *huecoActual()
+{
+    if (propietario.hueco != NULL || sinHueco)
+        return propietario.hueco;
+    for (int i = 0; i < Instrumentacion::MAX_HILOS; i++)
+    {
+        bool libre = false;
+        if (huecos[i].ocupado.compare_exchange_strong(libre, true, std::memory_order_acquire))
+        {
+            propietario.hueco = &huecos[i];
+            return propietario.hueco;
+        }
+    }
+    sinHueco = true;
+    return NULL;
+}
+
+int cubeta(uint32_t ns)
+{
+    uint32_t us = ns / 1000;
+    int k = 0;
+    while (us > 1 && k < Instrumentacion::NUM_CUBETAS - 1)
+    {
+        us >>= 1;
+        k++;
+    }
+    return k;
+}
+
+const char *nombres[Instrumentacion::NUM_MEDIDAS] = {
+    "captura", "conversion", "initialize", "etiquetado", "asignarBordes", "fusion",
+    "vecinosFrontera", "bottomUp", "segmentacion", "visor", "frame"
+};
+
+}
+
+std::atomic<bool> Instrumentacion::habilitada(false);
+
+void Instrumentacion::registrar(Medida medida, uint64_t ns)
+{
+    Hueco *h = huecoActual();
+    if (h == NULL)
+    {
+        nPerdidas.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Contador &c = h->medidas[medida];
+    uint64_t i = c.n.load(std::memory_order_relaxed);
+    c.ventana[i % VENTANA].store(ns > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)ns, std::memory_order_relaxed);
+    c.totalNs.store(c.totalNs.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+    c.n.store(i + 1, std::memory_order_release);
+}
+
+void Instrumentacion::resumen(Medida medida, Resumen &r)
+{
+    std::vector<uint32_t> muestras;
+    muestras.reserve(MAX_HILOS * VENTANA);
+    r.n = 0;
+    uint64_t totalNs = 0;
+    for (int t = 0; t < MAX_HILOS; t++)
+    {
+        const Contador &c = huecos[t].medidas[medida];
+        uint64_t n = c.n.load(std::memory_order_acquire);
+        r.n += n;
+        totalNs += c.totalNs.load(std::memory_order_relaxed);
+        uint64_t k = std::min<uint64_t>(n, VENTANA);
+        for (uint64_t i = 0; i < k; i++)
+            muestras.push_back(c.ventana[i].load(std::memory_order_relaxed));
+    }
+    r.totalUs = totalNs / 1000;
+    r.enVentana = (int)muestras.size();
+    std::fill(r.histograma, r.histograma + NUM_CUBETAS, 0);
+    r.mediaMs = r.p50Ms = r.p99Ms = r.maxMs = 0;
+    if (muestras.empty())
+        return;
+
+    double suma = 0;
+    for (size_t i = 0; i < muestras.size(); i++)
+    {
+        suma += muestras[i];
+        r.histograma[cubeta(muestras[i])]++;
+    }
+    std::sort(muestras.begin(), muestras.end());
+    size_t n = muestras.size();
+    r.mediaMs = suma / n * 1e-6;
+    r.p50Ms = muestras[n / 2] * 1e-6;
+    r.p99Ms = muestras[std::min(n - 1, (size_t)(0.99 * n))] * 1e-6;
+    r.maxMs = muestras[n - 1] * 1e-6;
+}
+
+void Instrumentacion::reiniciar()
+{
+    for (int t = 0; t < MAX_HILOS; t++)
+    {
+        for (int m = 0; m < NUM_MEDIDAS; m++)
+        {
+            huecos[t].medidas[m].n.store(0, std::memory_order_relaxed);
+            huecos[t].medidas[m].totalNs.store(0, std::memory_order_relaxed);
+        }
+    }
+    nPerdidas.store(0, std::memory_order_relaxed);
+}
+
+uint64_t Instrumentacion::perdidas()
+{
+    return nPerdidas.load(std::memory_order_relaxed);
+}
+
+const char *Instrumentacion::nombre(Medida medida)
+{
+    return medida >= 0 && medida < NUM_MEDIDAS ? nombres[medida] : "";
+}
+
+static unsigned long long us(double ms)
+{
+    return (unsigned long long)(ms * 1000 + 0.5);
+}
+
+bool Instrumentacion::volcarJSON(const std::string &ruta)
+{
+    FILE *f = fopen(ruta.c_str(), "w");
+    if (f == NULL)
+        return false;
+    fprintf(f, "{\n  \"perdidas\": %llu,\n  \"medidas\": [\n", (unsigned long long)perdidas());
+    for (int m = 0; m < NUM_MEDIDAS; m++)
+    {
+        Resumen r;
+        resumen((Medida)m, r);
+        fprintf(f, "    {\"nombre\": \"%s\", \"n\": %llu, \"total_us\": %llu, \"ventana\": %d, \"media_us\": %llu, "
+                   "\"p50_us\": %llu, \"p99_us\": %llu, \"max_us\": %llu, \"histograma\": [",
+                nombres[m], (unsigned long long)r.n, (unsigned long long)r.totalUs, r.enVentana,
+                us(r.mediaMs), us(r.p50Ms), us(r.p99Ms), us(r.maxMs));
+        for (int k = 0; k < NUM_CUBETAS; k++)
+            fprintf(f, k ? ", %u" : "%u", r.histograma[k]);
+        fprintf(f, "]}%s\n", m + 1 < NUM_MEDIDAS ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    return fclose(f) == 0;
+}
+
+bool Instrumentacion::volcarCSV(const std::string &ruta)
+{
+    FILE *f = fopen(ruta.c_str(), "w");
+    if (f == NULL)
+        return false;
+    fprintf(f, "medida,n,total_us,ventana,media_us,p50_us,p99_us,max_us");
+    for (int k = 0; k + 1 < NUM_CUBETAS; k++)
+        fprintf(f, ",lt_%lu_us", 2ul << k);
+    fprintf(f, ",ge_%lu_us", 1ul << (NUM_CUBETAS - 1));
+    fprintf(f, "\n");
+    for (int m = 0; m < NUM_MEDIDAS; m++)
+    {
+        Resumen r;
+        resumen((Medida)m, r);
+        fprintf(f, "%s,%llu,%llu,%d,%llu,%llu,%llu,%llu", nombres[m], (unsigned long long)r.n,
+                (unsigned long long)r.totalUs, r.enVentana, us(r.mediaMs), us(r.p50Ms), us(r.p99Ms), us(r.maxMs));
+        for (int k = 0; k < NUM_CUBETAS; k++)
+            fprintf(f, ",%u", r.histograma[k]);
+        fprintf(f, "\n");
+    }
+    return fclose(f) == 0;
+}
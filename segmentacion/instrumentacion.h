@@ -0,0 +1,107 @@
+#ifndef INSTRUMENTACION_H
+#define INSTRUMENTACION_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ * Tiempos por etapa de cada frame, pensados para dejarlos compilados en la aplicacion.
+ * Cada hilo escribe solo en su propio hueco (contadores atomicos sin cerrojos y una ventana
+ * circular con las ultimas muestras), asi que capturar y segmentar en hilos distintos no
+ * se estorba. Las lecturas juntan todos los huecos; pueden ver una muestra a medias, que
+ * para estadisticas de tiempos da igual.
+ * Desactivada, una medida cuesta una lectura relajada de un atomico: ni se lee el reloj.
+ */
+
+class Instrumentacion
+{
+public:
+    enum Medida{
+        MED_CAPTURA,            //lectura de la camara
+        MED_CONVERSION,         //resize y cvtColor del frame capturado
+        MED_INITIALIZE,         //blur, Canny y preparacion de buffers
+        MED_ETIQUETADO,         //bucle de crecimiento de regiones (motor elegido)
+        MED_ASIGNAR_BORDES,     //asignarBordesARegion
+        MED_FUSION,
+        MED_VECINOS_FRONTERA,   //vecinosFrontera
+        MED_BOTTOMUP,
+        MED_SEGMENTACION,       //Segmentador::segmentation entero
+        MED_VISOR,              //repintado de un ImgViewer
+        MED_FRAME,              //MainWindow::compute entero
+        NUM_MEDIDAS
+    };
+
+    static const int VENTANA = 128;     //muestras recientes por medida y por hilo
+    static const int NUM_CUBETAS = 20;  //histograma logaritmico: cubeta k = [2^k, 2^(k+1)) us
+    static const int MAX_HILOS = 32;
+
+    struct Resumen{
+        uint64_t n;             //muestras desde el ultimo reinicio
+        uint64_t totalUs;       //tiempo acumulado desde el ultimo reinicio
+        int enVentana;          //muestras usadas para lo demas (las mas recientes)
+        double mediaMs, p50Ms, p99Ms, maxMs;
+        uint32_t histograma[NUM_CUBETAS];
+    };
+
+    static void activar(bool activa) { habilitada.store(activa, std::memory_order_relaxed); }
+    static bool activa() { return habilitada.load(std::memory_order_relaxed); }
+
+    static uint64_t ahoraNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /** Anota una muestra en el hueco del hilo que llama */
+    static void registrar(Medida medida, uint64_t ns);
+
+    /** Estadisticas de una medida sobre la ventana reciente de todos los hilos */
+    static void resumen(Medida medida, Resumen &r);
+
+    /** Pone a cero todos los contadores (mejor con la instrumentacion desactivada) */
+    static void reiniciar();
+
+    //Muestras perdidas porque habia mas de MAX_HILOS hilos midiendo a la vez
+    static uint64_t perdidas();
+
+    static const char *nombre(Medida medida);
+
+    /** Vuelca el resumen de todas las medidas; los tiempos van en microsegundos enteros para
+     * que el formato no dependa del locale
+     * @return false si no se pudo escribir el fichero
+     */
+    static bool volcarJSON(const std::string &ruta);
+    static bool volcarCSV(const std::string &ruta);
+
+private:
+    static std::atomic<bool> habilitada;
+};
+
+/** Mide el ambito en el que se declara, si la instrumentacion esta activa al entrar */
+class Cronometro
+{
+public:
+    explicit Cronometro(Instrumentacion::Medida medida) :
+        medida(medida), midiendo(Instrumentacion::activa()), inicio(midiendo ? Instrumentacion::ahoraNs() : 0) {}
+    ~Cronometro()
+    {
+        if (midiendo)
+            Instrumentacion::registrar(medida, Instrumentacion::ahoraNs() - inicio);
+    }
+
+private:
+    Instrumentacion::Medida medida;
+    bool midiendo;
+    uint64_t inicio;
+
+    Cronometro(const Cronometro &);
+    Cronometro &operator=(const Cronometro &);
+};
+
+#endif // INSTRUMENTACION_H
@@ -0,0 +1,175 @@
+#include "pintado.h"
+
+#include <opencv2/core/hal/intrin.hpp>
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ *
+ */
+
+void PintorRegiones::pintar(const Mat &imgRegiones, const TablaRegiones &listRegiones, bool color, Rect zona,
+                            Mat *destGrayImage, Mat *destColorImage)
+{
+    CV_Assert(imgRegiones.type() == CV_16SC1 || imgRegiones.type() == CV_32SC1);
+    CV_Assert(destGrayImage == NULL || destGrayImage->type() == CV_8UC1);
+    CV_Assert(destColorImage == NULL || destColorImage->type() == CV_8UC3);
+
+    construirPaletas(listRegiones, color, destGrayImage != NULL, destColorImage != NULL);
+    if (etiquetasCortas(imgRegiones))
+        pintarT<short>(imgRegiones, zona, destGrayImage, destColorImage);
+    else
+        pintarT<int>(imgRegiones, zona, destGrayImage, destColorImage);
+}
+
+template<typename T>
+void PintorRegiones::pintarT(const Mat &imgRegiones, Rect zona, Mat *destGrayImage, Mat *destColorImage) const
+{
+    //Las dos salidas se escriben fila a fila, mientras la fila de etiquetas sigue en cache
+    for (int y = zona.y; y < zona.y + zona.height; y++)
+    {
+        const T *ids = imgRegiones.ptr<T>(y) + zona.x;
+        if (destGrayImage != NULL)
+            filaGris(ids, destGrayImage->ptr<uchar>(y) + zona.x, zona.width);
+        if (destColorImage != NULL)
+            filaColor(ids, destColorImage->ptr<uchar>(y) + 3 * zona.x, zona.width);
+    }
+}
+
+void PintorRegiones::construirPaletas(const TablaRegiones &listRegiones, bool color, bool gris, bool rgb)
+{
+    size_t n = listRegiones.size();
+    if (gris)
+    {
+        paletaGris.resize(n + 1);
+        paletaGris[0] = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            //En color el gris sale de rgbMedio con los pesos de COLOR_RGB2GRAY
+            const Vec3b &c = listRegiones.rgbMedio[i];
+            paletaGris[i + 1] = color ? (c[0] * 77 + c[1] * 150 + c[2] * 29 + 128) >> 8 : listRegiones.gMedio[i];
+        }
+    }
+    if (rgb)
+    {
+        paletaColor.resize(n + 1);
+        paletaColor[0] = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            //Byte a byte, para que el orden en memoria sea R, G, B sea cual sea el del int
+            uchar *p = (uchar *)&paletaColor[i + 1];
+            if (color)
+            {
+                const Vec3b &c = listRegiones.rgbMedio[i];
+                p[0] = c[0];
+                p[1] = c[1];
+                p[2] = c[2];
+            }
+            else
+                p[0] = p[1] = p[2] = listRegiones.gMedio[i];
+            p[3] = 0;
+        }
+    }
+}
+
+void PintorRegiones::filaGris(const int *ids, uchar *dest, int n) const
+{
+    //Desplazada una entrada, para indexar directamente con id (-1 es el negro)
+    const int *paleta = paletaGris.data() + 1;
+    int x = 0;
+#if CV_SIMD128
+    for (; x <= n - 16; x += 16)
+    {
+        v_int32x4 a = v_lut(paleta, v_load(ids + x));
+        v_int32x4 b = v_lut(paleta, v_load(ids + x + 4));
+        v_int32x4 c = v_lut(paleta, v_load(ids + x + 8));
+        v_int32x4 d = v_lut(paleta, v_load(ids + x + 12));
+        v_store(dest + x, v_pack_u(v_pack(a, b), v_pack(c, d)));
+    }
+#endif
+    for (; x < n; x++)
+        dest[x] = (uchar)paleta[ids[x]];
+}
+
+void PintorRegiones::filaGris(const short *ids, uchar *dest, int n) const
+{
+    const int *paleta = paletaGris.data() + 1;
+    int x = 0;
+#if CV_SIMD128
+    //Las etiquetas se cargan de 8 en 8 y se expanden a 32 bits para v_lut
+    for (; x <= n - 16; x += 16)
+    {
+        v_int32x4 a, b, c, d;
+        v_expand(v_load(ids + x), a, b);
+        v_expand(v_load(ids + x + 8), c, d);
+        a = v_lut(paleta, a);
+        b = v_lut(paleta, b);
+        c = v_lut(paleta, c);
+        d = v_lut(paleta, d);
+        v_store(dest + x, v_pack_u(v_pack(a, b), v_pack(c, d)));
+    }
+#endif
+    for (; x < n; x++)
+        dest[x] = (uchar)paleta[ids[x]];
+}
+
+#if CV_SIMD128
+//16 entradas RGBX de la paleta -> 16 pixeles RGB: se separan los canales y se vuelven a
+//entrelazar sin el relleno
+static inline void escribirColor(const v_int32x4 &a, const v_int32x4 &b, const v_int32x4 &c, const v_int32x4 &d,
+                                 uchar *dest)
+{
+    int rgbx[16];
+    v_store(rgbx, a);
+    v_store(rgbx + 4, b);
+    v_store(rgbx + 8, c);
+    v_store(rgbx + 12, d);
+    v_uint8x16 r, g, bl, x;
+    v_load_deinterleave((const uchar *)rgbx, r, g, bl, x);
+    v_store_interleave(dest, r, g, bl);
+}
+#endif
+
+void PintorRegiones::filaColor(const int *ids, uchar *dest, int n) const
+{
+    const int *paleta = paletaColor.data() + 1;
+    int x = 0;
+#if CV_SIMD128
+    for (; x <= n - 16; x += 16)
+    {
+        escribirColor(v_lut(paleta, v_load(ids + x)), v_lut(paleta, v_load(ids + x + 4)),
+                      v_lut(paleta, v_load(ids + x + 8)), v_lut(paleta, v_load(ids + x + 12)), dest + 3 * x);
+    }
+#endif
+    for (; x < n; x++)
+    {
+        const uchar *c = (const uchar *)(paleta + ids[x]);
+        dest[3 * x] = c[0];
+        dest[3 * x + 1] = c[1];
+        dest[3 * x + 2] = c[2];
+    }
+}
+
+void PintorRegiones::filaColor(const short *ids, uchar *dest, int n) const
+{
+    const int *paleta = paletaColor.data() + 1;
+    int x = 0;
+#if CV_SIMD128
+    for (; x <= n - 16; x += 16)
+    {
+        v_int32x4 a, b, c, d;
+        v_expand(v_load(ids + x), a, b);
+        v_expand(v_load(ids + x + 8), c, d);
+        escribirColor(v_lut(paleta, a), v_lut(paleta, b), v_lut(paleta, c), v_lut(paleta, d), dest + 3 * x);
+    }
+#endif
+    for (; x < n; x++)
+    {
+        const uchar *c = (const uchar *)(paleta + ids[x]);
+        dest[3 * x] = c[0];
+        dest[3 * x + 1] = c[1];
+        dest[3 * x + 2] = c[2];
+    }
+}
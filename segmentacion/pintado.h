@@ -0,0 +1,52 @@
+#ifndef PINTADO_H
+#define PINTADO_H
+
+#include <opencv2/core/core.hpp>
+
+#include <vector>
+
+#include "region.h"
+#include "etiquetas.h"
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ * Pintado de la imagen de etiquetas con el valor medio de cada region (bottomUp).
+ * Primero se construye una paleta densa id -> valor, de modo que el barrido por pixel solo
+ * lee la fila de etiquetas y una tabla pequena ya en el formato de salida.
+ * La entrada 0 de la paleta es el negro de los pixeles sin region (-1), asi que la
+ * consulta es paleta[id + 1] sin comparaciones. Las consultas van de 16 en 16 con v_lut
+ * (las etiquetas de 16 bits se expanden antes a 32); en color cada entrada es un int con
+ * R, G, B y relleno, que se separan por canal y se escriben entrelazados sin el relleno.
+ */
+
+using namespace cv;
+
+class PintorRegiones
+{
+public:
+    /** Pinta la zona de los destinos que no sean NULL, en una sola pasada sobre las etiquetas
+     * @param color las regiones traen rgbMedio (si no, gMedio); la otra salida se deriva de ella
+     */
+    void pintar(const Mat &imgRegiones, const TablaRegiones &listRegiones, bool color, Rect zona,
+                Mat *destGrayImage, Mat *destColorImage);
+
+    //Capacidad reservada por las paletas, para el contador de EspacioTrabajo
+    size_t capacidad() const { return paletaGris.capacity() + paletaColor.capacity(); }
+
+private:
+    std::vector<int> paletaGris;        //Gris por region como int, para v_lut
+    std::vector<int> paletaColor;       //Bytes R, G, B y relleno por region, para v_lut
+
+    void construirPaletas(const TablaRegiones &listRegiones, bool color, bool gris, bool rgb);
+    template<typename T>
+    void pintarT(const Mat &imgRegiones, Rect zona, Mat *destGrayImage, Mat *destColorImage) const;
+    void filaGris(const int *ids, uchar *dest, int n) const;
+    void filaGris(const short *ids, uchar *dest, int n) const;
+    void filaColor(const int *ids, uchar *dest, int n) const;
+    void filaColor(const short *ids, uchar *dest, int n) const;
+};
+
+#endif // PINTADO_H
@@ -0,0 +1,151 @@
+#include "planificador.h"
+
+#include <algorithm>
+#include <memory>
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ *
+ */
+
+//Trabajador que ejecuta el hilo actual (NULL fuera de cualquier planificador)
+static thread_local const PlanificadorTareas *planificadorActual = NULL;
+static thread_local int indiceActual = -1;
+
+static int hilosPorDefecto(int nHilos)
+{
+    if (nHilos <= 0)
+        nHilos = (int)std::thread::hardware_concurrency();
+    return std::max(nHilos, 1);
+}
+
+PlanificadorTareas::PlanificadorTareas(int nHilos) :
+    colas(hilosPorDefecto(nHilos)), pendientes(0), turno(0), robos(0), parar(false)
+{
+    for (size_t i = 0; i < colas.size(); i++)
+        hilos.push_back(std::thread(&PlanificadorTareas::bucle, this, (int)i));
+}
+
+PlanificadorTareas::~PlanificadorTareas()
+{
+    {
+        std::lock_guard<std::mutex> l(mDormir);
+        parar = true;
+    }
+    despertar.notify_all();
+    for (size_t i = 0; i < hilos.size(); i++)
+        hilos[i].join();
+}
+
+void PlanificadorTareas::lanzar(const Tarea &tarea)
+{
+    int i = planificadorActual == this ? indiceActual : (int)(turno++ % colas.size());
+    {
+        std::lock_guard<std::mutex> l(colas[i].m);
+        colas[i].tareas.push_back(tarea);
+    }
+    pendientes++;
+    //Se toma el cerrojo para que ningun trabajador se duerma entre comprobar pendientes y esperar
+    {
+        std::lock_guard<std::mutex> l(mDormir);
+    }
+    despertar.notify_one();
+}
+
+/** Ultima tarea de la cola propia o, si esta vacia, la primera de otra cola
+ * @brief PlanificadorTareas::sacar
+ */
+bool PlanificadorTareas::sacar(int indice, Tarea &tarea)
+{
+    {
+        Cola &c = colas[indice];
+        std::lock_guard<std::mutex> l(c.m);
+        if (!c.tareas.empty())
+        {
+            tarea.swap(c.tareas.back());
+            c.tareas.pop_back();
+            pendientes--;
+            return true;
+        }
+    }
+    for (size_t k = 1; k < colas.size(); k++)
+    {
+        Cola &c = colas[(indice + k) % colas.size()];
+        std::lock_guard<std::mutex> l(c.m);
+        if (!c.tareas.empty())
+        {
+            tarea.swap(c.tareas.front());
+            c.tareas.pop_front();
+            pendientes--;
+            robos.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void PlanificadorTareas::bucle(int indice)
+{
+    planificadorActual = this;
+    indiceActual = indice;
+    for (;;)
+    {
+        Tarea tarea;
+        if (sacar(indice, tarea))
+        {
+            tarea();
+            continue;
+        }
+        std::unique_lock<std::mutex> l(mDormir);
+        despertar.wait(l, [this] { return parar || pendientes.load() > 0; });
+        if (parar && pendientes.load() == 0)
+            return;
+    }
+}
+
+/** Las iteraciones se reparten con un contador compartido: el que llama y las tareas de
+ * ayuda toman la siguiente libre hasta agotarlas. Una ayuda que empieza tarde no encuentra
+ * iteraciones y termina sin tocar cuerpo, asi que al volver solo hay que esperar a las que
+ * ya estaban en marcha.
+ * @brief PlanificadorTareas::paraCada
+ */
+void PlanificadorTareas::paraCada(int n, const std::function<void(int)> &cuerpo)
+{
+    if (n <= 1 || hilos.size() <= 1)
+    {
+        for (int i = 0; i < n; i++)
+            cuerpo(i);
+        return;
+    }
+
+    struct Bucle{
+        std::atomic<int> siguiente;
+        std::atomic<int> terminadas;
+        int n;
+        const std::function<void(int)> *cuerpo;    //solo valido mientras quedan iteraciones
+    };
+    std::shared_ptr<Bucle> b = std::make_shared<Bucle>();
+    b->siguiente = 0;
+    b->terminadas = 0;
+    b->n = n;
+    b->cuerpo = &cuerpo;
+
+    Tarea ayuda = [b]
+    {
+        int i;
+        while ((i = b->siguiente.fetch_add(1)) < b->n)
+        {
+            (*b->cuerpo)(i);
+            b->terminadas.fetch_add(1, std::memory_order_release);
+        }
+    };
+    int nAyudas = std::min(n, (int)hilos.size()) - 1;
+    for (int k = 0; k < nAyudas; k++)
+        lanzar(ayuda);
+    ayuda();
+    while (b->terminadas.load(std::memory_order_acquire) < n)
+        std::this_thread::yield();
+}
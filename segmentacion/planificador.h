@@ -0,0 +1,72 @@
+#ifndef PLANIFICADOR_H
+#define PLANIFICADOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ * Conjunto fijo de hilos trabajadores con robo de tareas. Cada trabajador tiene su propia
+ * cola: las tareas que lanza van a ella y las saca por detras (la ultima lanzada, con los
+ * datos aun en cache); cuando se queda sin trabajo roba por delante de las colas de los
+ * demas. Las tareas lanzadas desde fuera del conjunto se reparten por turno.
+ *
+ * Las etapas del pipeline de frames (ver ejecutor.h) y los bucles paralelos de una etapa
+ * (franjas de UnionFind) comparten los mismos hilos, asi que no hay mas hilos que nucleos.
+ */
+
+class PlanificadorTareas
+{
+public:
+    typedef std::function<void()> Tarea;
+
+    /** @param nHilos trabajadores; 0 = uno por nucleo */
+    explicit PlanificadorTareas(int nHilos = 0);
+
+    //Termina las tareas pendientes antes de parar los hilos
+    ~PlanificadorTareas();
+
+    int numHilos() const { return (int)hilos.size(); }
+
+    void lanzar(const Tarea &tarea);
+
+    /** Ejecuta cuerpo(0) .. cuerpo(n - 1) en paralelo y vuelve cuando han terminado todos.
+     * El hilo que llama tambien ejecuta iteraciones, asi que se puede llamar desde una tarea
+     * aunque todos los trabajadores esten ocupados.
+     */
+    void paraCada(int n, const std::function<void(int)> &cuerpo);
+
+    uint64_t getRobos() const { return robos.load(std::memory_order_relaxed); }
+
+private:
+    struct Cola{
+        std::mutex m;
+        std::deque<Tarea> tareas;
+    };
+
+    std::vector<Cola> colas;        //una por trabajador
+    std::vector<std::thread> hilos;
+    std::atomic<int> pendientes;    //tareas en colas, sin empezar
+    std::atomic<unsigned> turno;    //cola para la siguiente tarea lanzada desde fuera
+    std::atomic<uint64_t> robos;
+    std::mutex mDormir;
+    std::condition_variable despertar;
+    bool parar;
+
+    void bucle(int indice);
+    bool sacar(int indice, Tarea &tarea);
+
+    PlanificadorTareas(const PlanificadorTareas &);
+    PlanificadorTareas &operator=(const PlanificadorTareas &);
+};
+
+#endif // PLANIFICADOR_H
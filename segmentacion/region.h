@@ -0,0 +1,91 @@
+#ifndef REGION_H
+#define REGION_H
+
+#include <opencv2/core/core.hpp>
+
+#include <vector>
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ *
+ */
+
+using namespace cv;
+
+/**
+ * Tabla de regiones como estructura de arrays: el campo de la region id esta en campo[id] y
+ * el id es la posicion en la tabla. Cada etapa solo trae a la cache los arrays que usa
+ * (bottomUp las medias, la asignacion de bordes nPuntos y caja...). Las fronteras van
+ * aparte, en Fronteras (CSR).
+ */
+class TablaRegiones
+{
+public:
+    std::vector<int> nPuntos;
+    std::vector<Point> pIni;            //Semilla, Point(columna, fila)
+    std::vector<uchar> gMedio;          //Valor gris medio
+    std::vector<Vec3b> rgbMedio;        //Valor color medio
+    std::vector<Rect> caja;             //Rectangulo minimo que contiene la region
+    std::vector<Vec3d> suma;            //Suma por canal (en grises solo suma[0])
+    std::vector<Vec3d> sumaCuadrados;   //Suma de cuadrados por canal, para la varianza
+
+    size_t size() const { return nPuntos.size(); }
+    bool empty() const { return nPuntos.empty(); }
+
+    void clear() { resize(0); }
+
+    //Las regiones nuevas quedan a cero
+    void resize(size_t n)
+    {
+        nPuntos.resize(n, 0);
+        pIni.resize(n, Point(0, 0));
+        gMedio.resize(n, 0);
+        rgbMedio.resize(n, Vec3b(0, 0, 0));
+        caja.resize(n, Rect());
+        suma.resize(n, Vec3d(0, 0, 0));
+        sumaCuadrados.resize(n, Vec3d(0, 0, 0));
+    }
+
+    /** Anade una region a cero al final
+     * @return su id
+     */
+    int anadir()
+    {
+        int id = (int)size();
+        resize(id + 1);
+        return id;
+    }
+
+    //Copia todos los campos de la region origen en destino
+    void copiar(int destino, int origen)
+    {
+        nPuntos[destino] = nPuntos[origen];
+        pIni[destino] = pIni[origen];
+        gMedio[destino] = gMedio[origen];
+        rgbMedio[destino] = rgbMedio[origen];
+        caja[destino] = caja[origen];
+        suma[destino] = suma[origen];
+        sumaCuadrados[destino] = sumaCuadrados[origen];
+    }
+
+    //Regiones reservadas, para el contador de EspacioTrabajo
+    size_t capacidad() const { return nPuntos.capacity(); }
+};
+
+//Entrada de cola de prioridad: un punto (o un par de ids) y su valor
+typedef struct{
+    Point point;
+    float valor;
+} punto;
+
+//Ordena de menor a mayor valor en std::priority_queue / std::push_heap
+struct puntoCompare {
+    bool operator()(const punto a, const punto b) const {
+        return a.valor > b.valor;
+    }
+};
+
+#endif // REGION_H
@@ -0,0 +1,319 @@
+#include "resultados.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ *
+ */
+
+static const char MAGIA[8] = { 'P', '4', 'S', 'E', 'G', 'R', 'E', 'S' };
+static const uint32_t VERSION = 1;
+
+//Las estructuras se leen tal cual de la proyeccion, asi que su tamano es parte del formato
+static_assert(sizeof(CabeceraFichero) == 48, "CabeceraFichero");
+static_assert(sizeof(CabeceraFrame) == 72, "CabeceraFrame");
+static_assert(sizeof(RegionDisco) == 48, "RegionDisco");
+static_assert(sizeof(Tramo) == 8, "Tramo");
+
+static uint64_t alinear(uint64_t n)
+{
+    return (n + 7) & ~(uint64_t)7;
+}
+
+int VistaFrame::etiqueta(int x, int y) const
+{
+    if (x < 0 || y < 0 || x >= ancho() || y >= alto())
+        return -1;
+    const Tramo *t = tramos + filas[y];
+    int n = (int)(filas[y + 1] - filas[y]);
+    if (n == 0)
+        return -1;
+    //Primer tramo que acaba despues de x
+    int a = 0, b = n - 1;
+    while (a < b)
+    {
+        int m = (a + b) / 2;
+        if (t[m].fin <= (uint32_t)x)
+            a = m + 1;
+        else
+            b = m;
+    }
+    //Una fila que no llega hasta x no lo cubre
+    return t[a].fin > (uint32_t)x ? t[a].id : -1;
+}
+
+void VistaFrame::etiquetas(Mat &imgRegiones) const
+{
+    imgRegiones.create(alto(), ancho(), CV_32SC1);
+    for (int y = 0; y < alto(); y++)
+    {
+        int *fila = imgRegiones.ptr<int>(y);
+        int x = 0;
+        for (uint32_t k = filas[y]; k < filas[y + 1]; k++)
+            for (; x < (int)std::min(tramos[k].fin, cabecera->ancho); x++)
+                fila[x] = tramos[k].id;
+        //Lo que no cubran los tramos queda sin region
+        for (; x < ancho(); x++)
+            fila[x] = -1;
+    }
+}
+
+EscritorResultados::EscritorResultados() : fichero(NULL), posicion(0), error(false)
+{
+}
+
+EscritorResultados::~EscritorResultados()
+{
+    cerrar();
+}
+
+bool EscritorResultados::abrir(const std::string &ruta)
+{
+    cerrar();
+    fichero = fopen(ruta.c_str(), "wb");
+    if (fichero == NULL)
+        return false;
+    posicion = 0;
+    error = false;
+    indice.clear();
+
+    //Cabecera provisional, sin frames, hasta cerrar
+    CabeceraFichero c;
+    memset(&c, 0, sizeof(c));
+    memcpy(c.magia, MAGIA, sizeof(MAGIA));
+    c.version = VERSION;
+    volcar(&c, sizeof(c));
+    return !error;
+}
+
+bool EscritorResultados::escribir(const Mat &imgRegiones, const TablaRegiones &listRegiones,
+                                  const Fronteras &fronteras, bool color, uint64_t numero)
+{
+    CV_Assert(imgRegiones.type() == CV_16SC1 || imgRegiones.type() == CV_32SC1);
+    CV_Assert(fronteras.numRegiones() == (int)listRegiones.size());
+    if (fichero == NULL || error)
+        return false;
+
+    if (etiquetasCortas(imgRegiones))
+        comprimir<short>(imgRegiones);
+    else
+        comprimir<int>(imgRegiones);
+
+    regiones.resize(listRegiones.size());
+    for (size_t i = 0; i < listRegiones.size(); i++)
+    {
+        RegionDisco &d = regiones[i];
+        memset(&d, 0, sizeof(d));
+        d.id = (int32_t)i;
+        d.semillaX = listRegiones.pIni[i].x;
+        d.semillaY = listRegiones.pIni[i].y;
+        d.nPuntos = listRegiones.nPuntos[i];
+        const Rect &caja = listRegiones.caja[i];
+        d.cajaX = caja.x;
+        d.cajaY = caja.y;
+        d.cajaAncho = caja.width;
+        d.cajaAlto = caja.height;
+        d.fronteraInicio = fronteras.inicio[i];
+        d.nFrontera = fronteras.tamano((int)i);
+        if (color)
+        {
+            const Vec3b &rgb = listRegiones.rgbMedio[i];
+            d.rgb[0] = rgb[0];
+            d.rgb[1] = rgb[1];
+            d.rgb[2] = rgb[2];
+            d.gris = (rgb[0] * 77 + rgb[1] * 150 + rgb[2] * 29 + 128) >> 8;
+        }
+        else
+            d.gris = d.rgb[0] = d.rgb[1] = d.rgb[2] = listRegiones.gMedio[i];
+    }
+
+    frontera.resize(fronteras.puntos.size());
+    for (size_t i = 0; i < fronteras.puntos.size(); i++)
+        frontera[i] = (uint32_t)(fronteras.puntos[i].y * imgRegiones.cols + fronteras.puntos[i].x);
+
+    CabeceraFrame c;
+    memset(&c, 0, sizeof(c));
+    c.numero = numero;
+    c.ancho = imgRegiones.cols;
+    c.alto = imgRegiones.rows;
+    c.nRegiones = (uint32_t)regiones.size();
+    c.color = color ? 1 : 0;
+    c.nTramos = (uint32_t)tramos.size();
+    c.nPuntosFrontera = (uint32_t)frontera.size();
+    c.desplRegiones = sizeof(CabeceraFrame);
+    c.desplFilas = c.desplRegiones + regiones.size() * sizeof(RegionDisco);
+    c.desplTramos = alinear(c.desplFilas + filas.size() * sizeof(uint32_t));
+    c.desplFrontera = c.desplTramos + tramos.size() * sizeof(Tramo);
+    c.tamano = alinear(c.desplFrontera + frontera.size() * sizeof(uint32_t));
+
+    uint64_t inicio = posicion;
+    indice.push_back(inicio);
+    volcar(&c, sizeof(c));
+    volcar(regiones.data(), regiones.size() * sizeof(RegionDisco));
+    volcar(filas.data(), filas.size() * sizeof(uint32_t));
+    rellenar();
+    volcar(tramos.data(), tramos.size() * sizeof(Tramo));
+    volcar(frontera.data(), frontera.size() * sizeof(uint32_t));
+    rellenar();
+    CV_Assert(error || posicion - inicio == c.tamano);
+    return !error;
+}
+
+/** Tramos por fila de imgRegiones; en el fichero las etiquetas son siempre de 32 bits
+ * @brief EscritorResultados::comprimir
+ */
+template<typename T>
+void EscritorResultados::comprimir(const Mat &imgRegiones)
+{
+    filas.resize(imgRegiones.rows + 1);
+    tramos.clear();
+    for (int y = 0; y < imgRegiones.rows; y++)
+    {
+        filas[y] = (uint32_t)tramos.size();
+        const T *fila = imgRegiones.ptr<T>(y);
+        for (int x = 0; x < imgRegiones.cols; x++)
+        {
+            if (x > 0 && fila[x] == fila[x - 1])
+                tramos.back().fin = x + 1;
+            else
+            {
+                Tramo t = { fila[x], (uint32_t)x + 1 };
+                tramos.push_back(t);
+            }
+        }
+    }
+    filas[imgRegiones.rows] = (uint32_t)tramos.size();
+}
+
+bool EscritorResultados::cerrar()
+{
+    if (fichero == NULL)
+        return false;
+
+    CabeceraFichero c;
+    memset(&c, 0, sizeof(c));
+    memcpy(c.magia, MAGIA, sizeof(MAGIA));
+    c.version = VERSION;
+    c.nFrames = (uint32_t)indice.size();
+    c.desplIndice = posicion;
+    volcar(indice.data(), indice.size() * sizeof(uint64_t));
+    if (!error && (fseek(fichero, 0, SEEK_SET) != 0 || fwrite(&c, sizeof(c), 1, fichero) != 1))
+        error = true;
+    if (fclose(fichero) != 0)
+        error = true;
+    fichero = NULL;
+    return !error;
+}
+
+void EscritorResultados::volcar(const void *datos, size_t bytes)
+{
+    if (error || bytes == 0)
+        return;
+    if (fwrite(datos, 1, bytes, fichero) != bytes)
+        error = true;
+    posicion += bytes;
+}
+
+void EscritorResultados::rellenar()
+{
+    static const uint8_t ceros[8] = { 0 };
+    volcar(ceros, alinear(posicion) - posicion);
+}
+
+LectorResultados::LectorResultados() : datos(NULL), tamano(0), cabecera(NULL), indice(NULL)
+{
+}
+
+LectorResultados::~LectorResultados()
+{
+    cerrar();
+}
+
+bool LectorResultados::abrir(const std::string &ruta)
+{
+    cerrar();
+    int fd = open(ruta.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(CabeceraFichero))
+    {
+        close(fd);
+        return false;
+    }
+    void *p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return false;
+    datos = (const uint8_t *)p;
+    tamano = st.st_size;
+
+    const CabeceraFichero *c = (const CabeceraFichero *)datos;
+    if (memcmp(c->magia, MAGIA, sizeof(MAGIA)) != 0 || c->version != VERSION || c->nFrames == 0
+            || c->desplIndice % 8 != 0 || c->desplIndice > tamano
+            || (tamano - c->desplIndice) / sizeof(uint64_t) < c->nFrames)
+    {
+        cerrar();
+        return false;
+    }
+    cabecera = c;
+    indice = (const uint64_t *)(datos + c->desplIndice);
+    return true;
+}
+
+void LectorResultados::cerrar()
+{
+    if (datos != NULL)
+        munmap((void *)datos, tamano);
+    datos = NULL;
+    tamano = 0;
+    cabecera = NULL;
+    indice = NULL;
+}
+
+bool LectorResultados::frame(int k, VistaFrame &vista) const
+{
+    if (cabecera == NULL || k < 0 || k >= (int)cabecera->nFrames)
+        return false;
+    uint64_t inicio = indice[k];
+    if (inicio % 8 != 0 || inicio > tamano || tamano - inicio < sizeof(CabeceraFrame))
+        return false;
+    const CabeceraFrame *c = (const CabeceraFrame *)(datos + inicio);
+    //Las secciones van seguidas y dentro del frame, que a su vez cabe en el fichero
+    if (c->tamano > tamano - inicio || c->desplRegiones < sizeof(CabeceraFrame)
+            || c->desplFilas < c->desplRegiones + (uint64_t)c->nRegiones * sizeof(RegionDisco)
+            || c->desplTramos < c->desplFilas + ((uint64_t)c->alto + 1) * sizeof(uint32_t)
+            || c->desplFrontera < c->desplTramos + (uint64_t)c->nTramos * sizeof(Tramo)
+            || c->desplFrontera + (uint64_t)c->nPuntosFrontera * sizeof(uint32_t) > c->tamano
+            || c->desplTramos % 8 != 0)
+        return false;
+
+    //Los indices de filas y regiones tienen que quedarse dentro de sus secciones
+    const RegionDisco *regiones = (const RegionDisco *)(datos + inicio + c->desplRegiones);
+    const uint32_t *filas = (const uint32_t *)(datos + inicio + c->desplFilas);
+    for (uint32_t y = 0; y < c->alto; y++)
+        if (filas[y] > filas[y + 1])
+            return false;
+    if (filas[c->alto] > c->nTramos)
+        return false;
+    for (uint32_t i = 0; i < c->nRegiones; i++)
+        if ((uint64_t)regiones[i].fronteraInicio + regiones[i].nFrontera > c->nPuntosFrontera)
+            return false;
+
+    vista.cabecera = c;
+    vista.regiones = regiones;
+    vista.filas = filas;
+    vista.tramos = (const Tramo *)(datos + inicio + c->desplTramos);
+    vista.frontera = (const uint32_t *)(datos + inicio + c->desplFrontera);
+    return true;
+}
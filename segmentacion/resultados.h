@@ -0,0 +1,166 @@
+#ifndef RESULTADOS_H
+#define RESULTADOS_H
+
+#include <opencv2/core/core.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "region.h"
+#include "frontera.h"
+#include "etiquetas.h"
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ * Formato binario de resultados de segmentacion, pensado para leerse con mmap sin analizar
+ * nada: todas las estructuras tienen tamano fijo, estan alineadas a 8 bytes y se usan
+ * directamente sobre la memoria del fichero (orden de bytes de la maquina, little-endian).
+ *
+ *   CabeceraFichero
+ *   frame 0, frame 1, ...      cada uno: CabeceraFrame, RegionDisco[nRegiones],
+ *                              uint32 filas[alto + 1], Tramo[nTramos], uint32 frontera[nPuntosFrontera]
+ *   uint64 indice[nFrames]     desplazamiento de cada frame desde el inicio del fichero
+ *
+ * imgRegiones va comprimida por tramos: los de la fila y son tramos[filas[y]] ..
+ * tramos[filas[y + 1] - 1], cada uno con su etiqueta y la columna donde acaba, asi que un pixel
+ * suelto se consulta con una busqueda binaria en su fila. Las fronteras son las de Fronteras
+ * (CSR) como indices de pixel y * ancho + x; cada region guarda donde empiezan las suyas.
+ * La cabecera del fichero se reescribe al cerrar; un fichero sin cerrar tiene nFrames = 0.
+ */
+
+using namespace cv;
+
+struct CabeceraFichero{
+    char magia[8];              //"P4SEGRES"
+    uint32_t version;
+    uint32_t nFrames;
+    uint64_t desplIndice;
+    uint64_t reservado[3];
+};
+
+struct CabeceraFrame{
+    uint64_t numero;            //Numero de frame en la secuencia de origen
+    uint32_t ancho, alto;
+    uint32_t nRegiones;
+    uint32_t color;             //1 si las medias son rgb, 0 si son gris
+    uint32_t nTramos;
+    uint32_t nPuntosFrontera;
+    uint64_t desplRegiones;     //Desplazamientos desde el inicio de la CabeceraFrame
+    uint64_t desplFilas;
+    uint64_t desplTramos;
+    uint64_t desplFrontera;
+    uint64_t tamano;            //Bytes del frame completo
+};
+
+struct RegionDisco{
+    int32_t id;
+    int32_t semillaX, semillaY;
+    int32_t nPuntos;
+    int32_t cajaX, cajaY, cajaAncho, cajaAlto;
+    uint32_t fronteraInicio;    //Primer punto en frontera[]
+    uint32_t nFrontera;
+    uint8_t gris;
+    uint8_t rgb[3];
+    uint32_t reservado;
+};
+
+struct Tramo{
+    int32_t id;                 //Etiqueta (-1 sin region)
+    uint32_t fin;               //Columna siguiente a la ultima del tramo
+};
+
+//Frame de un fichero abierto: punteros a la memoria del fichero, validos mientras siga abierto
+struct VistaFrame{
+    const CabeceraFrame *cabecera;
+    const RegionDisco *regiones;
+    const uint32_t *filas;
+    const Tramo *tramos;
+    const uint32_t *frontera;
+
+    int ancho() const { return (int)cabecera->ancho; }
+    int alto() const { return (int)cabecera->alto; }
+    int numRegiones() const { return (int)cabecera->nRegiones; }
+    const RegionDisco &region(int id) const { return regiones[id]; }
+    const uint32_t *fronteraDe(int id) const { return frontera + regiones[id].fronteraInicio; }
+
+    /** Etiqueta de un pixel, con una busqueda binaria en los tramos de su fila; -1 fuera de la
+     * imagen o si ningun tramo lo cubre */
+    int etiqueta(int x, int y) const;
+
+    /** Descomprime la imagen de etiquetas completa (CV_32SC1) */
+    void etiquetas(Mat &imgRegiones) const;
+};
+
+class EscritorResultados
+{
+public:
+    EscritorResultados();
+    ~EscritorResultados();
+
+    bool abrir(const std::string &ruta);
+
+    /** Anade un frame al final del fichero
+     * @param imgRegiones etiquetas CV_16SC1 o CV_32SC1
+     * @param fronteras las de imgRegiones (Segmentador::getFronteras)
+     * @param color las regiones traen rgbMedio (si no, gMedio)
+     */
+    bool escribir(const Mat &imgRegiones, const TablaRegiones &listRegiones, const Fronteras &fronteras,
+                  bool color, uint64_t numero);
+
+    /** Escribe el indice y la cabecera definitiva */
+    bool cerrar();
+
+    bool isOpened() const { return fichero != NULL; }
+
+private:
+    FILE *fichero;
+    uint64_t posicion;
+    bool error;
+    std::vector<uint64_t> indice;
+
+    //Buffers del frame, reutilizados
+    std::vector<RegionDisco> regiones;
+    std::vector<uint32_t> filas;
+    std::vector<Tramo> tramos;
+    std::vector<uint32_t> frontera;
+
+    template<typename T> void comprimir(const Mat &imgRegiones);
+    void volcar(const void *datos, size_t bytes);
+    void rellenar();
+};
+
+class LectorResultados
+{
+public:
+    LectorResultados();
+    ~LectorResultados();
+
+    /** Proyecta el fichero en memoria y comprueba cabecera e indice
+     * @return false si no existe, no es de este formato o no se cerro
+     */
+    bool abrir(const std::string &ruta);
+    void cerrar();
+
+    int numFrames() const { return cabecera != NULL ? (int)cabecera->nFrames : 0; }
+
+    /** Acceso directo al frame k, sin leer los anteriores
+     * @return false si k esta fuera de rango o el frame no cabe en el fichero
+     */
+    bool frame(int k, VistaFrame &vista) const;
+
+private:
+    const uint8_t *datos;
+    size_t tamano;
+    const CabeceraFichero *cabecera;
+    const uint64_t *indice;
+
+    LectorResultados(const LectorResultados &);
+    LectorResultados &operator=(const LectorResultados &);
+};
+
+#endif // RESULTADOS_H
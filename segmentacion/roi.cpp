@@ -0,0 +1,132 @@
+#include "roi.h"
+
+#include <algorithm>
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ *
+ */
+
+const int SegmentadorROI::MAX_ZONAS;
+const int SegmentadorROI::MARGEN;
+
+//Fondo del destino fuera de las ventanas: la entrada a media intensidad o tal cual
+static void fondo(const Mat &entrada, Mat &destino, bool atenuar)
+{
+    if (!atenuar)
+    {
+        entrada.copyTo(destino);
+        return;
+    }
+    destino.create(entrada.size(), entrada.type());
+    int n = entrada.cols * entrada.channels();
+    for (int y = 0; y < entrada.rows; y++)
+    {
+        const uchar *e = entrada.ptr<uchar>(y);
+        uchar *d = destino.ptr<uchar>(y);
+        for (int k = 0; k < n; k++)
+            d[k] = e[k] >> 1;
+    }
+}
+
+SegmentadorROI::SegmentadorROI() : planificador(NULL), atenuar(true)
+{
+}
+
+void SegmentadorROI::setVentanas(const std::vector<Rect> &ventanas)
+{
+    this->ventanas.assign(ventanas.begin(), ventanas.begin() + std::min((int)ventanas.size(), (int)MAX_ZONAS));
+    //Las zonas que siguen existiendo conservan su segmentador (y su estado incremental)
+    while (zonas.size() > this->ventanas.size())
+        zonas.pop_back();
+    while (zonas.size() < this->ventanas.size())
+    {
+        zonas.push_back(std::unique_ptr<Zona>(new Zona()));
+        zonas.back()->segmentador.setPlanificador(planificador);
+    }
+}
+
+void SegmentadorROI::setPlanificador(PlanificadorTareas *p)
+{
+    planificador = p;
+    for (size_t i = 0; i < zonas.size(); i++)
+        zonas[i]->segmentador.setPlanificador(p);
+}
+
+/** Copia la zona ampliada a buffers continuos propios y la segmenta entera
+ * @brief SegmentadorROI::segmentarZona
+ */
+void SegmentadorROI::segmentarZona(Zona &z, const Segmentador::Parametros &param, const Mat &color, const Mat &gray)
+{
+    color(z.ampliada).copyTo(z.color);
+    gray(z.ampliada).copyTo(z.gray);
+    z.segmentador.setParametros(param);
+    z.segmentador.segmentation(z.color, z.gray, z.destColor, z.destGray);
+}
+
+const Segmentador::Estadisticas &SegmentadorROI::segmentation(const Segmentador::Parametros &param, const Mat &color, const Mat &gray,
+                                                              Mat &destColorImage, Mat &destGrayImage)
+{
+    Rect imagen(0, 0, gray.cols, gray.rows);
+    std::vector<Zona *> activas;
+    for (size_t i = 0; i < zonas.size(); i++)
+    {
+        Zona &z = *zonas[i];
+        z.ventana = ventanas[i] & imagen;
+        Rect r(z.ventana.x - MARGEN, z.ventana.y - MARGEN, z.ventana.width + 2 * MARGEN, z.ventana.height + 2 * MARGEN);
+        z.ampliada = r & imagen;
+        if (z.ventana.area() > 0)
+            activas.push_back(&z);
+    }
+
+    if (planificador != NULL && activas.size() > 1)
+        planificador->paraCada((int)activas.size(), [&](int i) { segmentarZona(*activas[i], param, color, gray); });
+    else
+        for (size_t i = 0; i < activas.size(); i++)
+            segmentarZona(*activas[i], param, color, gray);
+
+    //Se pega en serie porque las ventanas se pueden solapar; gana la ultima seleccionada
+    bool conColor = param.color || param.ambasSalidas;
+    bool conGris = !param.color || param.ambasSalidas;
+    if (conColor)
+        fondo(color, destColorImage, atenuar);
+    if (conGris)
+        fondo(gray, destGrayImage, atenuar);
+    for (size_t i = 0; i < activas.size(); i++)
+    {
+        const Zona &z = *activas[i];
+        Rect interior(z.ventana.tl() - z.ampliada.tl(), z.ventana.size());
+        if (conColor)
+            z.destColor(interior).copyTo(destColorImage(z.ventana));
+        if (conGris)
+            z.destGray(interior).copyTo(destGrayImage(z.ventana));
+    }
+
+    sumarEstadisticas();
+    return estadisticas;
+}
+
+//Trabajo sumado de todas las ventanas; la region mayor es la mayor de cualquiera de ellas
+void SegmentadorROI::sumarEstadisticas()
+{
+    estadisticas = Segmentador::Estadisticas();
+    for (size_t i = 0; i < zonas.size(); i++)
+    {
+        if (zonas[i]->ventana.area() == 0)
+            continue;
+        const Segmentador::Estadisticas &e = zonas[i]->segmentador.getEstadisticas();
+        estadisticas.llamadasFloodFill += e.llamadasFloodFill;
+        estadisticas.pixelesRevisados += e.pixelesRevisados;
+        estadisticas.pixelesReclamados += e.pixelesReclamados;
+        estadisticas.pixelesBorde += e.pixelesBorde;
+        estadisticas.bordesSinVecino += e.bordesSinVecino;
+        estadisticas.numRegiones += e.numRegiones;
+        estadisticas.regionMayor = std::max(estadisticas.regionMayor, e.regionMayor);
+        estadisticas.puntosFrontera += e.puntosFrontera;
+        for (int k = 0; k < Segmentador::Estadisticas::NUM_CUBETAS; k++)
+            estadisticas.histogramaTamanos[k] += e.histogramaTamanos[k];
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef ROI_H
+#define ROI_H
+
+#include <opencv2/core/core.hpp>
+
+#include <memory>
+#include <vector>
+
+#include "segmentador.h"
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ * Segmentacion restringida a una o varias ventanas de la imagen. Cada ventana se amplia con
+ * un margen (para que blur, Canny y las regiones que cruzan el borde de la ventana vean
+ * contexto), se copia a un buffer propio y la segmenta su propio Segmentador, asi que bordes,
+ * etiquetado, asignacion de bordes y pintado solo recorren esa zona y el modo incremental
+ * conserva su estado por ventana. Del resultado solo se pega la ventana; fuera de las
+ * ventanas el destino es la entrada, atenuada o tal cual.
+ */
+
+using namespace cv;
+
+class SegmentadorROI
+{
+public:
+    static const int MAX_ZONAS = 4;
+    static const int MARGEN = 16;   //pixeles de contexto alrededor de cada ventana
+
+    SegmentadorROI();
+
+    /** Ventanas en coordenadas de imagen; se recortan a la imagen en cada frame */
+    void setVentanas(const std::vector<Rect> &ventanas);
+    int numZonas() const { return (int)zonas.size(); }
+
+    void setAtenuar(bool atenuar) { this->atenuar = atenuar; }
+
+    //Con planificador, las ventanas se segmentan en paralelo
+    void setPlanificador(PlanificadorTareas *p);
+
+    /** Segmenta las ventanas y compone el destino con el tamano de la entrada
+     * @return estadisticas sumadas de todas las ventanas
+     */
+    const Segmentador::Estadisticas &segmentation(const Segmentador::Parametros &param, const Mat &color, const Mat &gray,
+                                                  Mat &destColorImage, Mat &destGrayImage);
+
+    const Segmentador &getSegmentador(int zona) const { return zonas[zona]->segmentador; }
+    Rect getVentana(int zona) const { return zonas[zona]->ventana; }
+    const Segmentador::Estadisticas &getEstadisticas() const { return estadisticas; }
+
+private:
+    struct Zona{
+        Rect ventana, ampliada;  //ventana pedida y con el margen, ya recortadas a la imagen
+        Segmentador segmentador;
+        Mat color, gray, destColor, destGray;
+    };
+
+    std::vector<Rect> ventanas;
+    std::vector<std::unique_ptr<Zona> > zonas;
+    PlanificadorTareas *planificador;
+    bool atenuar;
+    Segmentador::Estadisticas estadisticas;
+
+    void segmentarZona(Zona &z, const Segmentador::Parametros &param, const Mat &color, const Mat &gray);
+    void sumarEstadisticas();
+};
+
+#endif // ROI_H
@@ -0,0 +1,55 @@
+#-------------------------------------------------
+#
+# Motor de segmentacion (biblioteca estatica, sin Qt)
+#
+#-------------------------------------------------
+
+QT -= core gui
+
+TARGET = segmentacion
+TEMPLATE = lib
+
+CONFIG += staticlib c++11
+CONFIG -= qt
+
+SOURCES += segmentador.cpp \
+    unionfind.cpp \
+    crecimiento.cpp \
+    captura.cpp \
+    espaciotrabajo.cpp \
+    frontera.cpp \
+    fusion.cpp \
+    cambios.cpp \
+    instrumentacion.cpp \
+    pintado.cpp \
+    bordes.cpp \
+    video.cpp \
+    resultados.cpp \
+    planificador.cpp \
+    ejecutor.cpp \
+    calidad.cpp \
+    roi.cpp
+
+HEADERS += segmentador.h \
+    region.h \
+    unionfind.h \
+    crecimiento.h \
+    captura.h \
+    colaspsc.h \
+    espaciotrabajo.h \
+    frontera.h \
+    fusion.h \
+    cambios.h \
+    instrumentacion.h \
+    pintado.h \
+    bordes.h \
+    video.h \
+    resultados.h \
+    vecindad.h \
+    etiquetas.h \
+    planificador.h \
+    ejecutor.h \
+    calidad.h \
+    roi.h
+
+INCLUDEPATH += /usr/local/include/opencv4
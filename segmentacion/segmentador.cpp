@@ -0,0 +1,667 @@
+#include "segmentador.h"
+
+#include <algorithm>
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ *
+ */
+
+//Suavizado fusionado: blur 3x3 convolucionado con Sobel 3x3, separable en derivada y suavizado.
+//Sin dividir por el area de la caja, las derivadas salen 9 veces mayores (maximo 255*4*12, cabe en 16 bits)
+static const float NUCLEO_DERIVADA[5] = { -1, -1, 0, 1, 1 };
+static const float NUCLEO_SUAVIZADO[5] = { 1, 3, 4, 3, 1 };
+static const int ESCALA_FUSIONADO = 9;
+
+static bool mismosParametros(const Segmentador::Parametros &a, const Segmentador::Parametros &b)
+{
+    return a.maxBox == b.maxBox && a.color == b.color && a.rangoFlotante == b.rangoFlotante
+            && a.motor == b.motor && a.franjas == b.franjas && a.umbralFusion == b.umbralFusion
+            && a.incremental == b.incremental && a.tamBloque == b.tamBloque && a.umbralCambio == b.umbralCambio
+            && a.ambasSalidas == b.ambasSalidas && a.conectividad == b.conectividad
+            && a.etiquetas16 == b.etiquetas16 && a.umbralCannyBajo == b.umbralCannyBajo
+            && a.umbralCannyAlto == b.umbralCannyAlto && a.suavizadoFusionado == b.suavizadoFusionado;
+}
+
+/** Sustituye la etiqueta de por a dentro de la caja c
+ * @return pixeles cambiados
+ */
+template<typename T>
+static int reetiquetarCaja(Mat &etiquetas, Rect c, int de, int a)
+{
+    int n = 0;
+    for(int y = c.y; y < c.y + c.height; y++){
+        T *fila = etiquetas.ptr<T>(y);
+        for(int x = c.x; x < c.x + c.width; x++){
+            if(fila[x] == de){
+                fila[x] = (T)a;
+                n++;
+            }
+        }
+    }
+    return n;
+}
+
+static int reetiquetarCaja(Mat &etiquetas, Rect c, int de, int a)
+{
+    if(etiquetasCortas(etiquetas))
+        return reetiquetarCaja<short>(etiquetas, c, de, a);
+    return reetiquetarCaja<int>(etiquetas, c, de, a);
+}
+
+/** Anota en ids, una vez cada una, las regiones con algun pixel en el bloque b
+ * @brief regionesDelBloque
+ */
+template<typename T>
+static void regionesDelBloque(const Mat &etiquetas, Rect b, std::vector<uchar> &anotada, std::vector<int> &ids)
+{
+    for(int y = b.y; y < b.y + b.height; y++){
+        const T *fila = etiquetas.ptr<T>(y);
+        for(int x = b.x; x < b.x + b.width; x++){
+            int id = fila[x];
+            if(id >= 0 && !anotada[id]){
+                anotada[id] = 1;
+                ids.push_back(id);
+            }
+        }
+    }
+}
+
+/** Deja sin region los pixeles de borde, descontandolos de su region
+ * @brief quitarBordes
+ */
+template<typename T>
+static void quitarBordes(Mat &etiquetas, const Mat &bordes, const Mat &img, TablaRegiones &lista)
+{
+    const int cn = img.channels();
+    for(int y = 0; y < etiquetas.rows; y++){
+        T *fila = etiquetas.ptr<T>(y);
+        const uchar *borde = bordes.ptr<uchar>(y);
+        const uchar *valor = img.ptr<uchar>(y);
+        for(int x = 0; x < etiquetas.cols; x++){
+            if(borde[x] == 255 && fila[x] >= 0){
+                int id = fila[x];
+                lista.nPuntos[id]--;
+                for(int c = 0; c < cn; c++){
+                    uchar v = valor[x * cn + c];
+                    lista.suma[id][c] -= v;
+                    lista.sumaCuadrados[id][c] -= v * v;
+                }
+                fila[x] = -1;
+            }
+        }
+    }
+}
+
+Segmentador::Segmentador()
+{
+    idReg = 0;
+    etiquetasAnchas = false;
+    mascaraMarcada = false;
+    destColorEscrito = NULL;
+    destGrayEscrito = NULL;
+}
+
+/** El siguiente frame se segmenta entero aunque el modo incremental este activo
+ * @brief Segmentador::invalidarDestino
+ */
+void Segmentador::invalidarDestino(){
+    destColorEscrito = NULL;
+    destGrayEscrito = NULL;
+    cambios.invalidar();
+}
+
+/** @return true si los destinos que rellena bottomUp son los que escribio en el frame anterior
+ * @brief Segmentador::destinoVigente
+ */
+bool Segmentador::destinoVigente(const Mat &destColorImage, const Mat &destGrayImage) const{
+    if((param.color || param.ambasSalidas) && (destColorImage.data == NULL || destColorImage.data != destColorEscrito))
+        return false;
+    if((!param.color || param.ambasSalidas) && (destGrayImage.data == NULL || destGrayImage.data != destGrayEscrito))
+        return false;
+    return true;
+}
+
+void Segmentador::initialize(Mat &destColorImage, Mat &destGrayImage){
+    //INICIALIZA PARÁMETROS COMO IMAGEN DE MÁSCARA Y HACE EL GUARDADO DE LA IMAGEN CANNY
+    Size tam = grayImage.size();
+
+    //Todos los buffers del frame se reservan aqui y solo si cambia el tamano o el tipo,
+    //de modo que blur, Canny, los motores y bottomUp escriben sobre memoria ya reservada
+    espacio.reservarBordes(tam);
+    espacio.reservarEtiquetas(tam, param.etiquetas16 && !etiquetasAnchas);
+    const Mat &entrada = param.color ? colorImage : grayImage;
+    if(param.suavizadoFusionado){
+        espacio.reservar(espacio.gradX, tam, CV_MAKETYPE(CV_16S, entrada.channels()));
+        espacio.reservar(espacio.gradY, tam, CV_MAKETYPE(CV_16S, entrada.channels()));
+    }else{
+        espacio.reservar(espacio.suavizada, tam, entrada.type());
+    }
+
+    //Canny escribe en el interior de imgMask, que es a la vez detected_edges y la mascara de floodFill
+    detectarBordes(entrada, Rect(0, 0, tam.width, tam.height), espacio.detected_edges);
+    mascaraMarcada = false;
+
+    //Con un destino de 3 canales la copia tiene que ser de la imagen en color,
+    //copiar grayImage cambiaba el tipo de destColorImage y lo reservaba en cada frame
+    if(param.color){
+        espacio.reservar(destColorImage, tam, CV_8UC3);
+        colorImage.copyTo(destColorImage, espacio.detected_edges);
+    }
+    else{
+        espacio.reservar(destGrayImage, tam, CV_8UC1);
+        grayImage.copyTo(destGrayImage, espacio.detected_edges);
+    }
+
+    //La otra salida solo hace falta si bottomUp tambien la rellena
+    if(param.ambasSalidas){
+        if(param.color)
+            espacio.reservar(destGrayImage, tam, CV_8UC1);
+        else
+            espacio.reservar(destColorImage, tam, CV_8UC3);
+    }
+
+    //Initialize regions img  and region list
+    espacio.imgRegiones.setTo(-1);
+    espacio.listRegiones.clear();
+}
+
+/** Canny de entrada(zona), escrito en bordes (del tamano de la zona). Por defecto blur 3x3 y
+ * Canny; con suavizadoFusionado las derivadas de la entrada suavizada salen de una sola pasada
+ * con nucleos separables de 5 y Canny parte de ellas, sin escribir ni volver a leer la imagen
+ * suavizada. Al no redondear el blur a 8 bits algun borde puede cambiar respecto al otro modo.
+ * @brief Segmentador::detectarBordes
+ */
+void Segmentador::detectarBordes(const Mat &entrada, Rect zona, Mat &bordes){
+    if(!param.suavizadoFusionado){
+        // Reduce noise with a kernel 3x3
+        Mat suavizada = espacio.suavizada(zona);
+        blur(entrada(zona), suavizada, Size(3, 3));
+
+        // Canny detector
+        cv::Canny(suavizada, bordes, param.umbralCannyBajo, param.umbralCannyAlto, 3);
+        return;
+    }
+    Mat derivada(1, 5, CV_32F, (void *)NUCLEO_DERIVADA);
+    Mat suavizado(1, 5, CV_32F, (void *)NUCLEO_SUAVIZADO);
+    Mat dx = espacio.gradX(zona);
+    Mat dy = espacio.gradY(zona);
+    //Fuera de la imagen se replica el borde, como en las derivadas de Canny
+    sepFilter2D(entrada(zona), dx, CV_16S, derivada, suavizado, Point(-1, -1), 0, BORDER_REPLICATE);
+    sepFilter2D(entrada(zona), dy, CV_16S, suavizado, derivada, Point(-1, -1), 0, BORDER_REPLICATE);
+    cv::Canny(dx, dy, bordes, ESCALA_FUSIONADO * param.umbralCannyBajo, ESCALA_FUSIONADO * param.umbralCannyAlto);
+}
+
+/** Quita de imgMask los pixeles rellenados por floodFill, para repetir el etiquetado con los
+ * mismos bordes; los bordes de Canny (255) no los toca floodFill
+ * @brief Segmentador::limpiarMascara
+ */
+void Segmentador::limpiarMascara(){
+    if(!mascaraMarcada)
+        return;
+    Mat &bordes = espacio.detected_edges;
+    for(int y = 0; y < bordes.rows; y++){
+        uchar *fila = bordes.ptr<uchar>(y);
+        for(int x = 0; x < bordes.cols; x++)
+            fila[x] = fila[x] == 255 ? 255 : 0;
+    }
+    mascaraMarcada = false;
+}
+
+/** SE ENCARGA DEL PROCESAMIENTO DE LA IMAGEN
+ * En modo incremental solo se recalcula lo que ha cambiado desde el frame anterior; para ello
+ * destColorImage/destGrayImage deben ser los mismos buffers del frame anterior y conservar su
+ * resultado (si se escriben por fuera hay que llamar a invalidarDestino).
+ * @brief Segmentador::segmentation
+ * @param color imagen RGB de entrada
+ * @param gray imagen en grises de entrada
+ * @param destColorImage resultado en color (solo si param.color)
+ * @param destGrayImage resultado en grises (solo si !param.color)
+ */
+const Segmentador::Estadisticas &Segmentador::segmentation(const Mat &color, const Mat &gray, Mat &destColorImage, Mat &destGrayImage){
+    Cronometro cronometro(Instrumentacion::MED_SEGMENTACION);
+    estadisticas = Estadisticas();
+
+    //Cabeceras de las imagenes de entrada, no se copian los datos
+    colorImage = color;
+    grayImage = gray;
+    const Mat &entrada = param.color ? colorImage : grayImage;
+    const Mat &destino = param.color ? destColorImage : destGrayImage;
+
+    if(param.incremental && mismosParametros(param, paramAnterior) && destino.size() == entrada.size()
+            && destinoVigente(destColorImage, destGrayImage)){
+        int nCambiados = cambios.comparar(entrada, param.umbralCambio);
+        if(nCambiados == 0){
+            //Escena estatica: etiquetas y regiones del frame anterior siguen valiendo; el destino
+            //se repinta por si el llamador lo ha tocado sin avisar
+            {
+                Cronometro c(Instrumentacion::MED_BOTTOMUP);
+                bottomUp(destColorImage, destGrayImage, Rect(0, 0, espacio.imgRegiones.cols, espacio.imgRegiones.rows));
+            }
+            telemetria = Telemetria();
+            telemetria.bloques = cambios.numBloques();
+            completarEstadisticas();
+            return estadisticas;
+        }
+        //Los bloques a recalcular son una cota inferior del area a recrecer: si ya pasan de la
+        //mitad no se intenta; si no, segmentacionIncremental decide con el area real
+        if(nCambiados > 0 && 2 * cambios.numRecalcular() <= cambios.numBloques()
+                && segmentacionIncremental(destColorImage, destGrayImage)){
+            telemetria.bloquesCambiados = nCambiados;
+            cambios.actualizar(entrada);
+            completarEstadisticas();
+            return estadisticas;
+        }
+    }
+
+    segmentacionCompleta(destColorImage, destGrayImage);
+
+    paramAnterior = param;
+    if(param.incremental)
+        cambios.referencia(entrada, param.tamBloque);
+    else
+        cambios.invalidar();
+
+    telemetria = Telemetria();
+    telemetria.completa = true;
+    telemetria.bloques = param.incremental ? cambios.numBloques() : 0;
+    telemetria.pixelesRecalculados = (int)entrada.total();
+    telemetria.regionesRecrecidas = (int)espacio.listRegiones.size();
+    telemetria.fraccion = 1.0;
+    completarEstadisticas();
+    return estadisticas;
+}
+
+void Segmentador::segmentacionCompleta(Mat &destColorImage, Mat &destGrayImage){
+    {
+        Cronometro c(Instrumentacion::MED_INITIALIZE);
+        initialize(destColorImage, destGrayImage);
+    }
+    {
+        Cronometro c(Instrumentacion::MED_ETIQUETADO);
+        etiquetar();
+    }
+    for(size_t i = 0; i < espacio.listRegiones.size(); i++)
+        estadisticas.pixelesReclamados += espacio.listRegiones.nPuntos[i];
+
+    // ######### POST-PROCESAMIENTO #########
+
+    {
+        Cronometro c(Instrumentacion::MED_ASIGNAR_BORDES);
+        asignarBordesARegion(Rect(0, 0, espacio.imgRegiones.cols, espacio.imgRegiones.rows));
+    }
+    if(param.umbralFusion > 0){
+        Cronometro c(Instrumentacion::MED_FUSION);
+        fusion.fusionar(espacio.imgRegiones, espacio.listRegiones, param.color, (float)param.umbralFusion);
+    }
+    {
+        Cronometro c(Instrumentacion::MED_VECINOS_FRONTERA);
+        vecinosFrontera();
+    }
+    {
+        Cronometro c(Instrumentacion::MED_BOTTOMUP);
+        bottomUp(destColorImage, destGrayImage, Rect(0, 0, espacio.imgRegiones.cols, espacio.imgRegiones.rows));
+    }
+
+    espacio.finFrame(capacidadAuxiliar());
+}
+
+//Capacidad de los buffers de fuera de EspacioTrabajo que se conservan entre frames
+size_t Segmentador::capacidadAuxiliar() const{
+    return unionFind.capacidad() + crecimiento.capacidad() + extractorFrontera.capacidad() + fusion.capacidad()
+            + pintor.capacidad() + asignador.capacidad() + regionSucia.capacity() + idsLibres.capacity()
+            + idsReutilizables.capacity();
+}
+
+/** Etiquetado con el motor elegido, sobre imgRegiones a -1 y listRegiones vacia.
+ * Si las regiones no caben en 16 bits se promueve imgRegiones y se repite; los frames
+ * siguientes empiezan en 32 bits hasta que vuelvan a caber con holgura.
+ * @brief Segmentador::etiquetar
+ */
+void Segmentador::etiquetar(){
+    if(!etiquetarMotor()){
+        espacio.promoverEtiquetas();
+        espacio.imgRegiones.setTo(-1);
+        espacio.listRegiones.clear();
+        etiquetarMotor();
+    }
+    etiquetasAnchas = !etiquetasCortas(espacio.imgRegiones)
+            && (int)espacio.listRegiones.size() >= Etiquetas<short>::MAX_REGIONES / 2;
+}
+
+/** @return false si las regiones no caben en el tipo de imgRegiones
+ * @brief Segmentador::etiquetarMotor
+ */
+bool Segmentador::etiquetarMotor(){
+    if(param.motor == MOTOR_UNIONFIND){
+        return unionFind.etiquetar(param.color ? colorImage : grayImage, espacio.detected_edges, param.maxBox,
+                                   param.rangoFlotante, param.conectividad, espacio.imgRegiones, espacio.listRegiones,
+                                   param.franjas);
+    }else if(param.motor == MOTOR_CRECIMIENTO){
+        return crecimiento.etiquetar(param.color ? colorImage : grayImage, espacio.detected_edges, param.maxBox,
+                                     param.rangoFlotante, param.conectividad, espacio.imgRegiones, espacio.listRegiones);
+    }
+    if(etiquetasCortas(espacio.imgRegiones))
+        return etiquetadoFloodFill<short>();
+    return etiquetadoFloodFill<int>();
+}
+
+/** Deja el estado como estaba justo antes de la etapa, tras una segmentation completa con
+ * la misma entrada. No forma parte de la medida.
+ * @brief Segmentador::prepararEtapa
+ */
+void Segmentador::prepararEtapa(Etapa etapa){
+    Mat &etiquetas = espacio.imgRegiones;
+    if(etapa == ETAPA_ETIQUETADO){
+        etiquetas.setTo(-1);
+        espacio.listRegiones.clear();
+        limpiarMascara();
+    }else if(etapa == ETAPA_ASIGNAR_BORDES){
+        //Los bordes vuelven a quedar sin region, como tras el etiquetado
+        const Mat &entrada = param.color ? colorImage : grayImage;
+        if(etiquetasCortas(etiquetas))
+            quitarBordes<short>(etiquetas, espacio.detected_edges, entrada, espacio.listRegiones);
+        else
+            quitarBordes<int>(etiquetas, espacio.detected_edges, entrada, espacio.listRegiones);
+    }
+}
+
+/** Ejecuta una sola etapa del pipeline completo, para medirla por separado
+ * @brief Segmentador::ejecutarEtapa
+ */
+void Segmentador::ejecutarEtapa(Etapa etapa, Mat &destColorImage, Mat &destGrayImage){
+    Rect imagen(0, 0, espacio.imgRegiones.cols, espacio.imgRegiones.rows);
+    switch(etapa){
+    case ETAPA_BORDES:
+        initialize(destColorImage, destGrayImage);
+        break;
+    case ETAPA_ETIQUETADO:
+        etiquetar();
+        break;
+    case ETAPA_ASIGNAR_BORDES:
+        asignarBordesARegion(imagen);
+        break;
+    case ETAPA_FRONTERA:
+        vecinosFrontera();
+        break;
+    case ETAPA_BOTTOMUP:
+        bottomUp(destColorImage, destGrayImage, imagen);
+        break;
+    default:
+        break;
+    }
+}
+
+/** Recalcula solo los bloques marcados por el detector de cambios y las regiones que los tocan.
+ * Las regiones que no tocan ningun bloque cambiado conservan etiquetas y estadisticas; las
+ * demas se borran enteras y se vuelven a crecer (con CrecimientoRegiones, que coincide con
+ * floodFill). Una region nueva no se une a una conservada aunque sean parecidas; para eso
+ * esta la fusion, que si esta activa se aplica a toda la imagen.
+ * @brief Segmentador::segmentacionIncremental
+ * @return false, sin tocar etiquetas ni regiones, si la zona a recrecer pasa de la mitad de la
+ * imagen; entonces compensa la segmentacion completa
+ */
+bool Segmentador::segmentacionIncremental(Mat &destColorImage, Mat &destGrayImage){
+    const Mat &entrada = param.color ? colorImage : grayImage;
+    Mat &etiquetas = espacio.imgRegiones;
+    TablaRegiones &lista = espacio.listRegiones;
+    Rect imagen(0, 0, etiquetas.cols, etiquetas.rows);
+
+    //Bordes de la zona cambiada, con margen para el blur y Canny
+    Rect zona = cambios.zona();
+    Rect conMargen = Rect(zona.x - 3, zona.y - 3, zona.width + 6, zona.height + 6) & imagen;
+    espacio.reservar(espacio.cannyZona, imagen.size(), CV_8UC1);
+    Mat bordesZona = espacio.cannyZona(conMargen);
+    {
+        Cronometro c(Instrumentacion::MED_INITIALIZE);
+        detectarBordes(entrada, conMargen, bordesZona);
+    }
+
+    //Solo se sustituyen los bloques a recalcular; se anotan las regiones que los tocan
+    regionSucia.assign(lista.size(), 0);
+    idsLibres.clear();
+    Size rejilla = cambios.rejilla();
+    for(int by = 0; by < rejilla.height; by++){
+        for(int bx = 0; bx < rejilla.width; bx++){
+            if(!cambios.hayQueRecalcular(by, bx))
+                continue;
+            Rect b = cambios.bloque(by, bx);
+            Rect local(b.x - conMargen.x, b.y - conMargen.y, b.width, b.height);
+            bordesZona(local).copyTo(espacio.detected_edges(b));
+            if(etiquetasCortas(etiquetas))
+                regionesDelBloque<short>(etiquetas, b, regionSucia, idsLibres);
+            else
+                regionesDelBloque<int>(etiquetas, b, regionSucia, idsLibres);
+        }
+    }
+
+    //Las regiones afectadas se borran enteras (su caja contiene todos sus pixeles) y se recrece
+    //el rectangulo que las cubre
+    Rect recalculo = zona;
+    for(size_t k = 0; k < idsLibres.size(); k++)
+        recalculo |= lista.caja[idsLibres[k]];
+    if(2 * recalculo.area() > imagen.area())
+        return false;
+    int pixeles = 0;
+    for(size_t k = 0; k < idsLibres.size(); k++){
+        int id = idsLibres[k];
+        pixeles += reetiquetarCaja(etiquetas, lista.caja[id], id, -1);
+    }
+    std::sort(idsLibres.begin(), idsLibres.end());
+
+    int nuevas = 0;
+    size_t nAntes = lista.size();
+    idsReutilizables = idsLibres;
+    {
+        Cronometro c(Instrumentacion::MED_ETIQUETADO);
+        //Si se acaban los ids de 16 bits se promueve y se sigue desde donde se ha parado
+        while(!crecimiento.etiquetarZona(entrada, espacio.detected_edges, param.maxBox, param.rangoFlotante,
+                                         param.conectividad, recalculo, etiquetas, lista, idsLibres, nuevas)){
+            espacio.promoverEtiquetas();
+            etiquetasAnchas = true;
+        }
+    }
+    //Regiones recrecidas: los primeros ids libres que se han usado y las anadidas al final
+    size_t usados = idsReutilizables.size() - idsLibres.size();
+    for(size_t k = 0; k < usados; k++)
+        estadisticas.pixelesReclamados += lista.nPuntos[idsReutilizables[k]];
+    for(size_t i = nAntes; i < lista.size(); i++)
+        estadisticas.pixelesReclamados += lista.nPuntos[i];
+    {
+        Cronometro c(Instrumentacion::MED_ASIGNAR_BORDES);
+        asignarBordesARegion(recalculo);
+    }
+    compactarRegiones();
+
+    //La fusion cambia medias en toda la imagen, asi que entonces el destino se rehace entero
+    Rect salida = recalculo;
+    if(param.umbralFusion > 0){
+        Cronometro c(Instrumentacion::MED_FUSION);
+        if(fusion.fusionar(etiquetas, lista, param.color, (float)param.umbralFusion) > 0)
+            salida = imagen;
+    }
+    {
+        Cronometro c(Instrumentacion::MED_VECINOS_FRONTERA);
+        vecinosFrontera();
+    }
+    {
+        Cronometro c(Instrumentacion::MED_BOTTOMUP);
+        bottomUp(destColorImage, destGrayImage, salida);
+    }
+
+    espacio.finFrame(capacidadAuxiliar());
+
+    telemetria = Telemetria();
+    telemetria.bloques = cambios.numBloques();
+    telemetria.bloquesRecalculados = cambios.numRecalcular();
+    telemetria.pixelesRecalculados = pixeles;
+    telemetria.regionesRecrecidas = nuevas;
+    telemetria.fraccion = (double)pixeles / imagen.area();
+    return true;
+}
+
+/** Ocupa los ids que han quedado libres con las ultimas regiones de la lista, para que
+ * listRegiones siga sin huecos; solo se reetiquetan los pixeles de las regiones movidas.
+ * @brief Segmentador::compactarRegiones
+ */
+void Segmentador::compactarRegiones(){
+    TablaRegiones &lista = espacio.listRegiones;
+    int n = (int)lista.size();
+    size_t h = 0, e = idsLibres.size();
+    while(h < e){
+        if(idsLibres[e - 1] == n - 1){
+            e--;
+            n--;
+            continue;
+        }
+        int hueco = idsLibres[h++];
+        int ultimo = n - 1;
+        reetiquetarCaja(espacio.imgRegiones, lista.caja[ultimo], ultimo, hueco);
+        lista.copiar(hueco, ultimo);
+        n--;
+    }
+    lista.resize(n);
+}
+
+/** Etiquetado original: floodFill desde cada semilla sin etiquetar y reescaneo de minRect
+ * @brief Segmentador::etiquetadoFloodFill
+ * @return false si las regiones no caben en T
+ */
+template<typename T>
+bool Segmentador::etiquetadoFloodFill(){
+    //La mascara es imgMask tal como la ha dejado Canny; si ya se ha etiquetado con ella
+    //(reintento en 32 bits) se quitan antes las marcas del intento anterior
+    limpiarMascara();
+    mascaraMarcada = true;
+
+    idReg = 0;
+    Point seedPoint;
+    int grisAcum, R_Acum, G_Acum, B_Acum, nPuntos;
+    Vec3d cuadAcum;
+    Scalar maxDif = Scalar::all(param.maxBox);
+    int flags = param.conectividad|(1 << 8)| FLOODFILL_MASK_ONLY;
+    if(!param.rangoFlotante)
+        flags |= FLOODFILL_FIXED_RANGE;
+
+    for(int i = 0; i<espacio.imgRegiones.rows; i++){
+        for(int j = 0; j<espacio.imgRegiones.cols; j++){
+            if(espacio.imgRegiones.at<T>(i,j) == -1 && espacio.detected_edges.at<uchar>(i,j) != 255){
+                if(idReg >= Etiquetas<T>::MAX_REGIONES)
+                    return false;
+                seedPoint.x = j;
+                seedPoint.y = i;
+                //Comprobación de imagen en color o grises
+                if(param.color){
+                    cv::floodFill(colorImage, espacio.imgMask, seedPoint,idReg, &minRect, maxDif, maxDif, flags);
+                }else{
+                    cv::floodFill(grayImage, espacio.imgMask, seedPoint,idReg, &minRect, maxDif, maxDif, flags);
+                }
+                estadisticas.llamadasFloodFill++;
+                estadisticas.pixelesRevisados += minRect.area();
+
+                grisAcum = 0;
+                R_Acum = 0;
+                G_Acum = 0;
+                B_Acum = 0;
+                cuadAcum = Vec3d(0, 0, 0);
+                nPuntos = 0;
+                for(int k = minRect.x; k < minRect.x+minRect.width; k++){ 		//columnas
+                    for(int z = minRect.y; z < minRect.y+minRect.height; z++){ 	//filas
+                        if(espacio.imgMask.at<uchar>(z+1, k+1) == 1 && espacio.imgRegiones.at<T>(z, k) == -1){
+                            nPuntos++;
+                            if(param.color){
+                                Vec3b rgb = colorImage.at<Vec3b>(z, k);
+                                R_Acum += rgb[0];
+                                G_Acum += rgb[1];
+                                B_Acum += rgb[2];
+                                for(int c = 0; c < 3; c++)
+                                    cuadAcum[c] += rgb[c] * rgb[c];
+                            }
+                            else{
+                                uchar g = grayImage.at<uchar>(z, k);
+                                grisAcum += g;
+                                cuadAcum[0] += g * g;
+                            }
+                            espacio.imgRegiones.at<T>(z, k) = (T)idReg;
+                        }
+                    }
+                }
+                TablaRegiones &lista = espacio.listRegiones;
+                lista.anadir();
+                lista.nPuntos[idReg] = nPuntos;
+                lista.pIni[idReg] = seedPoint;                          //Primer pixel en el barrido, como en los otros motores
+                lista.caja[idReg] = minRect;
+                lista.sumaCuadrados[idReg] = cuadAcum;
+                if(param.color){
+                    lista.suma[idReg] = Vec3d(R_Acum, G_Acum, B_Acum);
+                    lista.rgbMedio[idReg] = Vec3b(R_Acum/nPuntos, G_Acum/nPuntos, B_Acum/nPuntos);
+                }
+                else{
+                    lista.suma[idReg] = Vec3d(grisAcum, 0, 0);
+                    lista.gMedio[idReg] = grisAcum / nPuntos;
+                }
+                idReg++;
+            }
+        }
+    }
+    return true;
+}
+
+/** Extrae los puntos frontera de todas las regiones al buffer CSR del espacio de trabajo
+ * @brief Segmentador::vecinosFrontera
+ */
+void Segmentador::vecinosFrontera()
+{
+    extractorFrontera.extraer(espacio.imgRegiones, (int)espacio.listRegiones.size(), espacio.fronteras);
+}
+
+/** Asigna en el destino el valor medio de la region de cada pixel (negro en los que no tienen)
+ * @brief Segmentador::bottomUp
+ * @param zona parte del destino que se rehace
+ */
+void Segmentador::bottomUp(Mat &destColorImage, Mat &destGrayImage, Rect zona)
+{
+    //Se escribe directamente en los destinos, que ya se reservaron en initialize
+    bool gris = !param.color || param.ambasSalidas;
+    bool color = param.color || param.ambasSalidas;
+    pintor.pintar(espacio.imgRegiones, espacio.listRegiones, param.color, zona,
+                  gris ? &destGrayImage : NULL, color ? &destColorImage : NULL);
+    destColorEscrito = color ? destColorImage.data : NULL;
+    destGrayEscrito = gris ? destGrayImage.data : NULL;
+}
+
+/** Metodo encargado de asignar los bordes a una de las posibles regiones de la imagen.
+ * Crecimiento desde todas las regiones a la vez por cubetas de diferencia (ver bordes.h).
+ * @brief Segmentador::asignarBordesARegion
+ * @param zona parte de la imagen en la que se buscan pixeles sin region
+ */
+void Segmentador::asignarBordesARegion(Rect zona)
+{
+    int pixelesBorde, sinRegion;
+    asignador.asignar(param.color ? colorImage : grayImage, zona, espacio.imgRegiones, espacio.listRegiones,
+                      pixelesBorde, sinRegion);
+    estadisticas.pixelesBorde += pixelesBorde;
+    estadisticas.bordesSinVecino += sinRegion;
+}
+
+/** Numero de regiones, histograma de tamanos y puntos frontera del resultado vigente
+ * @brief Segmentador::completarEstadisticas
+ */
+void Segmentador::completarEstadisticas()
+{
+    const TablaRegiones &lista = espacio.listRegiones;
+    estadisticas.numRegiones = (int)lista.size();
+    estadisticas.puntosFrontera = (int64)espacio.fronteras.puntos.size();
+    for(size_t i = 0; i < lista.size(); i++){
+        int n = lista.nPuntos[i];
+        if(n > estadisticas.regionMayor)
+            estadisticas.regionMayor = n;
+        int k = 0;
+        while((n >>= 1) > 0 && k < Estadisticas::NUM_CUBETAS - 1)
+            k++;
+        estadisticas.histogramaTamanos[k]++;
+    }
+}
@@ -0,0 +1,193 @@
+#ifndef SEGMENTADOR_H
+#define SEGMENTADOR_H
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <vector>
+
+#include "region.h"
+#include "unionfind.h"
+#include "crecimiento.h"
+#include "espaciotrabajo.h"
+#include "fusion.h"
+#include "cambios.h"
+#include "instrumentacion.h"
+#include "pintado.h"
+#include "bordes.h"
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ * Motor de segmentacion independiente de la interfaz grafica.
+ */
+
+using namespace cv;
+
+class Segmentador
+{
+public:
+
+    //Motores de etiquetado disponibles
+    enum Motor{
+        MOTOR_FLOODFILL,    //cv::floodFill por semilla + reescaneo de minRect
+        MOTOR_UNIONFIND,    //union-find en dos pasadas (ver unionfind.h)
+        MOTOR_CRECIMIENTO   //crecimiento con estadisticas acumuladas (ver crecimiento.h)
+    };
+
+    //Parametros que antes se leian de la interfaz (max_box, colorButton, showFloatingRange_checkbox).
+    //Se fijan antes de cada frame y no cambian durante la segmentacion: los nucleos se eligen una
+    //vez por etapa segun canales, rango y conectividad, y no consultan nada por pixel.
+    struct Parametros{
+        int maxBox;
+        bool color;
+        bool rangoFlotante;
+        Motor motor;
+        int franjas;        //MOTOR_UNIONFIND en rango flotante: franjas etiquetadas en paralelo (1 = serie)
+        int umbralFusion;   //Diferencia de medias maxima para fusionar regiones adyacentes (0 = sin fusion)
+        bool incremental;   //Video: recalcular solo los bloques que cambian respecto al frame anterior
+        int tamBloque;      //Lado de los bloques del modo incremental, en pixeles
+        int umbralCambio;   //Diferencia por pixel a partir de la cual un bloque ha cambiado (ruido del sensor)
+        bool ambasSalidas;  //bottomUp rellena destColorImage y destGrayImage en la misma pasada
+        int conectividad;   //4 u 8, para el etiquetado (los bordes se asignan siempre con la 8-vecindad)
+        bool etiquetas16;   //imgRegiones en 16 bits mientras quepan las regiones (si no, siempre 32)
+        int umbralCannyBajo;        //Umbrales de histeresis de Canny, sobre la entrada suavizada
+        int umbralCannyAlto;
+        bool suavizadoFusionado;    //El blur 3x3 se aplica dentro de las derivadas de Canny (ver detectarBordes)
+
+        Parametros() : maxBox(5), color(false), rangoFlotante(false), motor(MOTOR_FLOODFILL), franjas(1),
+            umbralFusion(0), incremental(false), tamBloque(16), umbralCambio(10), ambasSalidas(false),
+            conectividad(4), etiquetas16(true), umbralCannyBajo(40), umbralCannyAlto(120),
+            suavizadoFusionado(false) {}
+    };
+
+    //Trabajo hecho en el ultimo frame
+    struct Telemetria{
+        bool completa;              //Segmentacion desde cero
+        int bloques;                //Bloques de la rejilla (0 fuera del modo incremental)
+        int bloquesCambiados;
+        int bloquesRecalculados;    //Cambiados y sus vecinos
+        int pixelesRecalculados;    //Pixeles cuyas regiones se han vuelto a crecer
+        int regionesRecrecidas;
+        double fraccion;            //pixelesRecalculados / pixeles de la imagen
+
+        Telemetria() : completa(false), bloques(0), bloquesCambiados(0), bloquesRecalculados(0),
+            pixelesRecalculados(0), regionesRecrecidas(0), fraccion(0) {}
+    };
+
+    //Trabajo algoritmico y contenido del ultimo frame, para relacionar los picos de latencia con la escena
+    struct Estadisticas{
+        static const int NUM_CUBETAS = 24;  //histograma de tamanos: cubeta k = [2^k, 2^(k+1)) pixeles
+
+        //Trabajo hecho en este frame
+        int llamadasFloodFill;          //MOTOR_FLOODFILL
+        int64 pixelesRevisados;         //Pixeles visitados por los reescaneos de minRect (MOTOR_FLOODFILL)
+        int64 pixelesReclamados;        //Pixeles etiquetados por el motor (sin contar los bordes)
+        int pixelesBorde;               //Pixeles sin region tras el etiquetado (asignarBordesARegion)
+        int bordesSinVecino;            //...a los que no llega ninguna region
+
+        //Resultado vigente tras el frame
+        int numRegiones;
+        int regionMayor;                //Pixeles de la region mas grande
+        int64 puntosFrontera;           //Puntos frontera de todas las regiones (Fronteras::puntos)
+        int histogramaTamanos[NUM_CUBETAS];
+
+        Estadisticas() : llamadasFloodFill(0), pixelesRevisados(0), pixelesReclamados(0), pixelesBorde(0),
+            bordesSinVecino(0), numRegiones(0), regionMayor(0), puntosFrontera(0)
+        {
+            for(int k = 0; k < NUM_CUBETAS; k++)
+                histogramaTamanos[k] = 0;
+        }
+    };
+
+    //Etapas de la segmentacion completa, en orden
+    enum Etapa{
+        ETAPA_BORDES,           //initialize: blur + Canny (o Canny sobre las derivadas fusionadas)
+        ETAPA_ETIQUETADO,       //motor de etiquetado
+        ETAPA_ASIGNAR_BORDES,   //asignarBordesARegion
+        ETAPA_FRONTERA,         //vecinosFrontera
+        ETAPA_BOTTOMUP,         //bottomUp
+        NUM_ETAPAS
+    };
+
+    Segmentador();
+
+    void setParametros(const Parametros &p) { param = p; }
+    const Parametros &getParametros() const { return param; }
+
+    //Hilos para las etapas paralelas (franjas de union-find); NULL = los de OpenCV
+    void setPlanificador(PlanificadorTareas *p) { unionFind.setPlanificador(p); }
+
+    //Devuelve las estadisticas del frame, validas hasta la siguiente llamada
+    const Estadisticas &segmentation(const Mat &color, const Mat &gray, Mat &destColorImage, Mat &destGrayImage);
+
+    //Etapas sueltas, para medirlas por separado. Requieren una segmentation previa con la misma
+    //entrada; prepararEtapa (fuera de la medida) deja el estado como antes de la etapa.
+    void prepararEtapa(Etapa etapa);
+    void ejecutarEtapa(Etapa etapa, Mat &destColorImage, Mat &destGrayImage);
+
+    //Etiquetas CV_16SC1 o CV_32SC1 segun el numero de regiones (ver etiquetas.h)
+    const Mat &getImgRegiones() const { return espacio.imgRegiones; }
+    const TablaRegiones &getListRegiones() const { return espacio.listRegiones; }
+    const Fronteras &getFronteras() const { return espacio.fronteras; }
+    const Telemetria &getTelemetria() const { return telemetria; }
+    const Estadisticas &getEstadisticas() const { return estadisticas; }
+
+    //Quien escriba en los destinos fuera de segmentation debe llamarla: el modo incremental
+    //solo repinta lo que cambia y supone que el resto sigue siendo su salida anterior
+    void invalidarDestino();
+
+    //Reservas de memoria de los buffers del frame; en regimen estable no deberia crecer
+    uint64 getReservas() const { return espacio.getReservas(); }
+    void resetReservas() { espacio.resetReservas(); }
+
+private:
+    Parametros param;
+
+    Mat colorImage, grayImage;
+    int idReg;
+
+    EspacioTrabajo espacio; //Buffers reutilizados entre frames
+    bool etiquetasAnchas;   //El ultimo etiquetado no cabia holgado en 16 bits: el siguiente empieza en 32
+    Rect minRect; //Minima ventana de los puntos modificados (añadidos a la region)
+    bool mascaraMarcada;    //floodFill ha dejado sus marcas en imgMask desde el ultimo Canny
+
+    UnionFind unionFind;
+    CrecimientoRegiones crecimiento;
+    ExtractorFrontera extractorFrontera;
+    FusionRegiones fusion;
+    PintorRegiones pintor;
+    AsignadorBordes asignador;
+
+    //Modo incremental
+    DetectorCambios cambios;
+    Parametros paramAnterior;           //Parametros de la ultima segmentacion completa
+    Telemetria telemetria;
+    std::vector<uchar> regionSucia;
+    std::vector<int> idsLibres;         //Ids de las regiones borradas, en orden creciente
+    std::vector<int> idsReutilizables;  //Copia de idsLibres antes de recrecer, para las estadisticas
+    const uchar *destColorEscrito;      //Datos de los destinos del ultimo bottomUp (NULL si no son
+    const uchar *destGrayEscrito;       //nuestros o alguien los ha tocado despues)
+
+    Estadisticas estadisticas;
+
+    void initialize(Mat &destColorImage, Mat &destGrayImage);
+    void detectarBordes(const Mat &entrada, Rect zona, Mat &bordes);
+    void limpiarMascara();
+    void segmentacionCompleta(Mat &destColorImage, Mat &destGrayImage);
+    size_t capacidadAuxiliar() const;
+    void etiquetar();
+    bool etiquetarMotor();
+    bool destinoVigente(const Mat &destColorImage, const Mat &destGrayImage) const;
+    bool segmentacionIncremental(Mat &destColorImage, Mat &destGrayImage);
+    void compactarRegiones();
+    template<typename T> bool etiquetadoFloodFill();
+    void vecinosFrontera();
+    void bottomUp(Mat &destColorImage, Mat &destGrayImage, Rect zona);
+    void asignarBordesARegion(Rect zona);
+    void completarEstadisticas();
+};
+
+#endif // SEGMENTADOR_H
@@ -0,0 +1,514 @@
+#include "unionfind.h"
+#include "vecindad.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ *
+ */
+
+template<int CN>
+static inline bool similares(const uchar *a, const uchar *b, int maxDif)
+{
+    for (int c = 0; c < CN; c++)
+        if (abs(a[c] - b[c]) > maxDif)
+            return false;
+    return true;
+}
+
+bool UnionFind::etiquetar(const Mat &img, const Mat &bordes, int maxDif, bool rangoFlotante, int conectividad,
+                          Mat &imgRegiones, TablaRegiones &listRegiones, int nFranjas)
+{
+    CV_Assert(img.type() == CV_8UC1 || img.type() == CV_8UC3);
+    CV_Assert(bordes.type() == CV_8UC1 && bordes.rows == img.rows && bordes.cols == img.cols);
+    CV_Assert(conectividad == 4 || conectividad == 8);
+
+    imgRegiones.create(img.rows, img.cols, tipoEtiquetas(imgRegiones));
+    CV_Assert(imgRegiones.isContinuous());
+    listRegiones.clear();
+
+    size_t n = (size_t)img.rows * img.cols;
+    padre.resize(n);
+    if (!rangoFlotante)
+    {
+        minimo.resize(n * img.channels());
+        maximo.resize(n * img.channels());
+    }
+
+    nFranjas = std::min(nFranjas, img.rows);
+    int nucleo = (img.channels() == 3 ? 4 : 0) | (rangoFlotante ? 2 : 0) | (conectividad == 8 ? 1 : 0);
+    bool cabe;
+    switch (nucleo)
+    {
+    case 0: cabe = etiquetarT<1, false, 4>(img, bordes, maxDif, imgRegiones, listRegiones, nFranjas); break;
+    case 1: cabe = etiquetarT<1, false, 8>(img, bordes, maxDif, imgRegiones, listRegiones, nFranjas); break;
+    case 2: cabe = etiquetarT<1, true, 4>(img, bordes, maxDif, imgRegiones, listRegiones, nFranjas); break;
+    case 3: cabe = etiquetarT<1, true, 8>(img, bordes, maxDif, imgRegiones, listRegiones, nFranjas); break;
+    case 4: cabe = etiquetarT<3, false, 4>(img, bordes, maxDif, imgRegiones, listRegiones, nFranjas); break;
+    case 5: cabe = etiquetarT<3, false, 8>(img, bordes, maxDif, imgRegiones, listRegiones, nFranjas); break;
+    case 6: cabe = etiquetarT<3, true, 4>(img, bordes, maxDif, imgRegiones, listRegiones, nFranjas); break;
+    default: cabe = etiquetarT<3, true, 8>(img, bordes, maxDif, imgRegiones, listRegiones, nFranjas); break;
+    }
+    if (cabe)
+        medias(img.channels(), listRegiones);
+    return cabe;
+}
+
+/** La primera pasada no depende del ancho de las etiquetas; solo las pasadas que escriben
+ * imgRegiones se instancian para 16 y 32 bits
+ * @brief UnionFind::etiquetarT
+ */
+template<int CN, bool FLOTANTE, int CONEX>
+bool UnionFind::etiquetarT(const Mat &img, const Mat &bordes, int maxDif, Mat &imgRegiones,
+                           TablaRegiones &listRegiones, int nFranjas)
+{
+    bool cortas = etiquetasCortas(imgRegiones);
+    //Rango fijo: la pertenencia depende del orden de barrido, asi que las franjas no se pueden
+    //etiquetar por separado sin cambiar el resultado y se etiqueta en serie
+    if (nFranjas > 1 && FLOTANTE)
+    {
+        if (cortas)
+            return etiquetarParalelo<CN, CONEX, short>(img, bordes, maxDif, imgRegiones, listRegiones, nFranjas);
+        return etiquetarParalelo<CN, CONEX, int>(img, bordes, maxDif, imgRegiones, listRegiones, nFranjas);
+    }
+    primeraPasada<CN, FLOTANTE, CONEX>(img, bordes, maxDif, 0, img.rows);
+    if (cortas)
+        return segundaPasada<CN, short>(img, imgRegiones, listRegiones);
+    return segundaPasada<CN, int>(img, imgRegiones, listRegiones);
+}
+
+/** Recorre las filas [y0, y1) uniendo cada pixel con sus vecinos ya visitados: izquierdo y
+ * superior, y en 8-vecindad tambien los dos diagonales de arriba.
+ * La fila y0 no se une con la anterior: de eso se encarga unirCostura.
+ * @brief UnionFind::primeraPasada
+ */
+template<int CN, bool FLOTANTE, int CONEX>
+void UnionFind::primeraPasada(const Mat &img, const Mat &bordes, int maxDif, int y0, int y1)
+{
+    const int cols = img.cols;
+    const int nPrevios = CONEX == 8 ? 4 : 2;
+
+    for (int y = y0; y < y1; y++)
+    {
+        const uchar *fila = img.ptr<uchar>(y);
+        const uchar *borde = bordes.ptr<uchar>(y);
+
+        for (int x = 0; x < cols; x++)
+        {
+            int idx = y * cols + x;
+            if (borde[x] == 255)
+            {
+                padre[idx] = -1;
+                continue;
+            }
+            padre[idx] = idx;
+
+            //Vecinos ya visitados: izquierdo, superior y (8-vecindad) superior izquierdo y derecho
+            const uchar *p = fila + x * CN;
+            int previo[4];
+            previo[0] = (x > 0 && padre[idx - 1] >= 0) ? idx - 1 : -1;
+            previo[1] = (y > y0 && padre[idx - cols] >= 0) ? idx - cols : -1;
+            if (CONEX == 8)
+            {
+                previo[2] = (y > y0 && x > 0 && padre[idx - cols - 1] >= 0) ? idx - cols - 1 : -1;
+                previo[3] = (y > y0 && x + 1 < cols && padre[idx - cols + 1] >= 0) ? idx - cols + 1 : -1;
+            }
+
+            if (FLOTANTE)
+            {
+                //Relacion simetrica entre vecinos: basta con unir las raices
+                for (int k = 0; k < nPrevios; k++)
+                {
+                    int q = previo[k];
+                    if (q < 0 || !similares<CN>(p, img.ptr<uchar>(q / cols) + (q % cols) * CN, maxDif))
+                        continue;
+                    int a = buscar(q);
+                    int b = buscar(idx);
+                    if (a != b)
+                        padre[std::max(a, b)] = std::min(a, b);
+                }
+                continue;
+            }
+
+            //Rango fijo: se compara con la semilla (raiz) de cada region vecina y el pixel se
+            //une a la mas antigua que lo acepta
+            int raices[4];
+            int raiz = -1;
+            for (int k = 0; k < nPrevios; k++)
+            {
+                raices[k] = previo[k] >= 0 ? buscar(previo[k]) : -1;
+                for (int j = 0; j < k; j++)
+                    if (raices[j] == raices[k])
+                        raices[k] = -1;
+                int r = raices[k];
+                if (r >= 0 && (raiz < 0 || r < raiz) &&
+                        similares<CN>(p, img.ptr<uchar>(r / cols) + (r % cols) * CN, maxDif))
+                    raiz = r;
+            }
+
+            if (raiz < 0)
+            {
+                //Nueva semilla
+                for (int c = 0; c < CN; c++)
+                    minimo[idx * CN + c] = maximo[idx * CN + c] = p[c];
+                continue;
+            }
+
+            padre[idx] = raiz;
+            for (int c = 0; c < CN; c++)
+            {
+                minimo[raiz * CN + c] = std::min(minimo[raiz * CN + c], p[c]);
+                maximo[raiz * CN + c] = std::max(maximo[raiz * CN + c], p[c]);
+            }
+
+            for (int k = 0; k < nPrevios; k++)
+                if (raices[k] > raiz)
+                    fusionarSiCabe<CN>(img, raiz, raices[k], maxDif);
+        }
+    }
+}
+
+/** Rango fijo: la region mas antigua (raiz) absorbe a la otra si todos sus pixeles caben en su rango
+ * @brief UnionFind::fusionarSiCabe
+ */
+template<int CN>
+bool UnionFind::fusionarSiCabe(const Mat &img, int raiz, int otra, int maxDif)
+{
+    const int cols = img.cols;
+    const uchar *semilla = img.ptr<uchar>(raiz / cols) + (raiz % cols) * CN;
+    for (int c = 0; c < CN; c++)
+    {
+        int lo = std::min(minimo[raiz * CN + c], minimo[otra * CN + c]);
+        int hi = std::max(maximo[raiz * CN + c], maximo[otra * CN + c]);
+        if (lo < semilla[c] - maxDif || hi > semilla[c] + maxDif)
+            return false;
+    }
+
+    padre[otra] = raiz;
+    for (int c = 0; c < CN; c++)
+    {
+        minimo[raiz * CN + c] = std::min(minimo[raiz * CN + c], minimo[otra * CN + c]);
+        maximo[raiz * CN + c] = std::max(maximo[raiz * CN + c], maximo[otra * CN + c]);
+    }
+    return true;
+}
+
+/** Asigna identificadores en orden de semilla y acumula las estadisticas de cada region
+ * @brief UnionFind::segundaPasada
+ * @return false si hay mas regiones de las que caben en T
+ */
+template<int CN, typename T>
+bool UnionFind::segundaPasada(const Mat &img, Mat &imgRegiones, TablaRegiones &listRegiones)
+{
+    const int cols = img.cols;
+    T *etiquetas = imgRegiones.ptr<T>(0);
+    suma.clear();
+    sumaCuadrados.clear();
+    limites.clear();
+
+    for (int y = 0; y < img.rows; y++)
+    {
+        const uchar *fila = img.ptr<uchar>(y);
+        for (int x = 0; x < cols; x++)
+        {
+            int idx = y * cols + x;
+            if (padre[idx] < 0)
+            {
+                etiquetas[idx] = -1;
+                continue;
+            }
+
+            //La raiz es el primer pixel de su componente, ya etiquetado al llegar aqui
+            int raiz = buscar(idx);
+            int id;
+            if (raiz == idx)
+            {
+                if ((int)listRegiones.size() >= Etiquetas<T>::MAX_REGIONES)
+                    return false;
+                id = listRegiones.anadir();
+                listRegiones.pIni[id] = Point(x, y);
+                suma.resize(suma.size() + CN, 0);
+                sumaCuadrados.resize(sumaCuadrados.size() + CN, 0);
+                limites.push_back(Vec4i(x, y, x, y));
+            }
+            else
+                id = etiquetas[raiz];
+
+            etiquetas[idx] = (T)id;
+            listRegiones.nPuntos[id]++;
+            for (int c = 0; c < CN; c++)
+            {
+                int v = fila[x * CN + c];
+                suma[id * CN + c] += v;
+                sumaCuadrados[id * CN + c] += v * v;
+            }
+            Vec4i &lim = limites[id];
+            if (x < lim[0]) lim[0] = x;
+            if (x > lim[2]) lim[2] = x;
+            lim[3] = y;
+        }
+    }
+    return true;
+}
+
+/** Etiquetado por franjas en rango flotante: primera pasada y estadisticas locales en paralelo,
+ * union de costuras en serie y renumeracion final en paralelo
+ * @brief UnionFind::etiquetarParalelo
+ */
+template<int CN, int CONEX, typename T>
+bool UnionFind::etiquetarParalelo(const Mat &img, const Mat &bordes, int maxDif, Mat &imgRegiones,
+                                  TablaRegiones &listRegiones, int nFranjas)
+{
+    const int alto = (img.rows + nFranjas - 1) / nFranjas;
+    nFranjas = (img.rows + alto - 1) / alto;
+    franjas.resize(nFranjas);
+    for (int s = 0; s < nFranjas; s++)
+    {
+        franjas[s].y0 = s * alto;
+        franjas[s].y1 = std::min(img.rows, (s + 1) * alto);
+    }
+
+    //Cada franja solo escribe en sus filas de padre, minimo, maximo e imgRegiones
+    paralelo(nFranjas, [&](int s)
+    {
+        primeraPasada<CN, true, CONEX>(img, bordes, maxDif, franjas[s].y0, franjas[s].y1);
+        franjas[s].cabe = estadisticasFranja<CN, T>(img, imgRegiones, franjas[s]);
+    });
+    for (int s = 0; s < nFranjas; s++)
+        if (!franjas[s].cabe)
+            return false;
+
+    for (int s = 1; s < nFranjas; s++)
+        unirCostura<CN, CONEX>(img, franjas[s].y0, maxDif);
+
+    if (!regionesGlobales<CN, T>(img, imgRegiones, listRegiones))
+        return false;
+
+    paralelo(nFranjas, [&](int s)
+    {
+        const std::vector<int> &global = franjas[s].global;
+        for (int y = franjas[s].y0; y < franjas[s].y1; y++)
+        {
+            T *etiqueta = imgRegiones.ptr<T>(y);
+            for (int x = 0; x < img.cols; x++)
+                if (etiqueta[x] >= 0)
+                    etiqueta[x] = (T)global[etiqueta[x]];
+        }
+    });
+    return true;
+}
+
+size_t UnionFind::capacidad() const
+{
+    size_t total = franjas.capacity() + padre.capacity() + minimo.capacity() + maximo.capacity()
+            + suma.capacity() + sumaCuadrados.capacity() + limites.capacity();
+    for (size_t s = 0; s < franjas.size(); s++)
+    {
+        const Franja &f = franjas[s];
+        total += f.raices.capacity() + f.nPuntos.capacity() + f.suma.capacity() + f.sumaCuadrados.capacity()
+                + f.limites.capacity() + f.global.capacity();
+    }
+    return total;
+}
+
+void UnionFind::paralelo(int n, const std::function<void(int)> &cuerpo)
+{
+    if (planificador != NULL)
+    {
+        planificador->paraCada(n, cuerpo);
+        return;
+    }
+    cv::parallel_for_(Range(0, n), [&](const Range &rango)
+    {
+        for (int s = rango.start; s < rango.end; s++)
+            cuerpo(s);
+    });
+}
+
+/** Numera las regiones locales de una franja (guardando el indice local en imgRegiones) y acumula sus estadisticas
+ * @brief UnionFind::estadisticasFranja
+ * @return false si la franja tiene mas regiones locales de las que caben en T
+ */
+template<int CN, typename T>
+bool UnionFind::estadisticasFranja(const Mat &img, Mat &imgRegiones, Franja &f)
+{
+    const int cols = img.cols;
+    T *etiquetas = imgRegiones.ptr<T>(0);
+    f.raices.clear();
+    f.nPuntos.clear();
+    f.suma.clear();
+    f.sumaCuadrados.clear();
+    f.limites.clear();
+
+    for (int y = f.y0; y < f.y1; y++)
+    {
+        const uchar *fila = img.ptr<uchar>(y);
+        for (int x = 0; x < cols; x++)
+        {
+            int idx = y * cols + x;
+            if (padre[idx] < 0)
+            {
+                etiquetas[idx] = -1;
+                continue;
+            }
+
+            int raiz = buscar(idx);
+            int local;
+            if (raiz == idx)
+            {
+                local = (int)f.raices.size();
+                if (local >= Etiquetas<T>::MAX_REGIONES)
+                    return false;
+                f.raices.push_back(idx);
+                f.nPuntos.push_back(0);
+                f.suma.resize(f.suma.size() + CN, 0);
+                f.sumaCuadrados.resize(f.sumaCuadrados.size() + CN, 0);
+                f.limites.push_back(Vec4i(x, y, x, y));
+            }
+            else
+                local = etiquetas[raiz];
+
+            etiquetas[idx] = (T)local;
+            f.nPuntos[local]++;
+            for (int c = 0; c < CN; c++)
+            {
+                int v = fila[x * CN + c];
+                f.suma[local * CN + c] += v;
+                f.sumaCuadrados[local * CN + c] += v * v;
+            }
+            Vec4i &lim = f.limites[local];
+            if (x < lim[0]) lim[0] = x;
+            if (x > lim[2]) lim[2] = x;
+            lim[3] = y;
+        }
+    }
+    return true;
+}
+
+/** Une las regiones de la fila y con las de la fila y-1 usando la misma regla que primeraPasada
+ * en rango flotante
+ * @brief UnionFind::unirCostura
+ */
+template<int CN, int CONEX>
+void UnionFind::unirCostura(const Mat &img, int y, int maxDif)
+{
+    const int cols = img.cols;
+
+    for (int x = 0; x < cols; x++)
+    {
+        int idx = y * cols + x;
+        if (padre[idx] < 0)
+            continue;
+        unirPar<CN>(img, idx - cols, idx, maxDif);
+        if (CONEX == 8)
+        {
+            if (x > 0)
+                unirPar<CN>(img, idx - cols - 1, idx, maxDif);
+            if (x + 1 < cols)
+                unirPar<CN>(img, idx - cols + 1, idx, maxDif);
+        }
+    }
+}
+
+/** Une las regiones de los pixeles vecinos p (fila de arriba) y q si son similares
+ * @brief UnionFind::unirPar
+ */
+template<int CN>
+void UnionFind::unirPar(const Mat &img, int p, int q, int maxDif)
+{
+    const int cols = img.cols;
+    if (padre[p] < 0)
+        return;
+    if (!similares<CN>(img.ptr<uchar>(p / cols) + (p % cols) * CN, img.ptr<uchar>(q / cols) + (q % cols) * CN, maxDif))
+        return;
+
+    int a = buscar(p);
+    int b = buscar(q);
+    if (a != b)
+        padre[std::max(a, b)] = std::min(a, b);
+}
+
+/** Asigna el id final de cada region local en orden de semilla y suma sus estadisticas
+ * @brief UnionFind::regionesGlobales
+ */
+template<int CN, typename T>
+bool UnionFind::regionesGlobales(const Mat &img, Mat &imgRegiones, TablaRegiones &listRegiones)
+{
+    const int cols = img.cols;
+    const int alto = franjas[0].y1 - franjas[0].y0;
+    const T *etiquetas = imgRegiones.ptr<T>(0);
+    suma.clear();
+    sumaCuadrados.clear();
+    limites.clear();
+
+    //Las franjas y sus regiones locales se recorren en orden de barrido, asi que la raiz
+    //global de cada region ya tiene id cuando se llega a las regiones que absorbio
+    for (size_t s = 0; s < franjas.size(); s++)
+    {
+        Franja &f = franjas[s];
+        f.global.resize(f.raices.size());
+        for (size_t j = 0; j < f.raices.size(); j++)
+        {
+            int raiz = buscar(f.raices[j]);
+            int id;
+            if (raiz == f.raices[j])
+            {
+                if ((int)listRegiones.size() >= Etiquetas<T>::MAX_REGIONES)
+                    return false;
+                id = listRegiones.anadir();
+                listRegiones.pIni[id] = Point(raiz % cols, raiz / cols);
+                suma.resize(suma.size() + CN, 0);
+                sumaCuadrados.resize(sumaCuadrados.size() + CN, 0);
+                limites.push_back(f.limites[j]);
+            }
+            else
+                id = franjas[(raiz / cols) / alto].global[etiquetas[raiz]];
+            f.global[j] = id;
+
+            listRegiones.nPuntos[id] += f.nPuntos[j];
+            for (int c = 0; c < CN; c++)
+            {
+                suma[id * CN + c] += f.suma[j * CN + c];
+                sumaCuadrados[id * CN + c] += f.sumaCuadrados[j * CN + c];
+            }
+            Vec4i &lim = limites[id];
+            const Vec4i &limLocal = f.limites[j];
+            lim[0] = std::min(lim[0], limLocal[0]);
+            lim[1] = std::min(lim[1], limLocal[1]);
+            lim[2] = std::max(lim[2], limLocal[2]);
+            lim[3] = std::max(lim[3], limLocal[3]);
+        }
+    }
+    return true;
+}
+
+/** Completa caja, sumas y valor medio de cada region a partir de los acumulados
+ * @brief UnionFind::medias
+ */
+void UnionFind::medias(int cn, TablaRegiones &listRegiones)
+{
+    for (size_t i = 0; i < listRegiones.size(); i++)
+    {
+        const Vec4i &lim = limites[i];
+        int n = listRegiones.nPuntos[i];
+        listRegiones.caja[i] = Rect(lim[0], lim[1], lim[2] - lim[0] + 1, lim[3] - lim[1] + 1);
+        Vec3d &s = listRegiones.suma[i], &s2 = listRegiones.sumaCuadrados[i];
+        for (int c = 0; c < cn; c++)
+        {
+            s[c] = (double)suma[i * cn + c];
+            s2[c] = (double)sumaCuadrados[i * cn + c];
+        }
+        if (cn == 3)
+        {
+            for (int c = 0; c < cn; c++)
+                listRegiones.rgbMedio[i][c] = (uchar)(suma[i * cn + c] / n);
+        }
+        else
+            listRegiones.gMedio[i] = (uchar)(suma[i] / n);
+    }
+}
@@ -0,0 +1,117 @@
+#ifndef UNIONFIND_H
+#define UNIONFIND_H
+
+#include <opencv2/core/core.hpp>
+
+#include <functional>
+#include <vector>
+
+#include "region.h"
+#include "etiquetas.h"
+#include "planificador.h"
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ * Etiquetado de componentes conexas (4 u 8-vecindad) en dos pasadas con union-find.
+ * Cada pixel se visita un numero constante de veces, sin floodFill ni reescaneo de minRect.
+ *
+ * Rango flotante: p y q vecinos se unen si |p - q| <= maxDif en cada canal. Es una relacion
+ * simetrica, asi que el resultado coincide pixel a pixel con cv::floodFill en rango flotante.
+ *
+ * Rango fijo: la pertenencia depende de la semilla de la region (su primer pixel en orden de
+ * barrido, que es siempre la raiz). Un pixel se une a la region vecina si esta a maxDif de su
+ * semilla, y dos regiones solo se fusionan si su [min, max] cabe en semilla +- maxDif.
+ * Todas las regiones cumplen la condicion de rango fijo, pero donde floodFill reparte pixeles
+ * segun el orden en que crecen las semillas el resultado puede diferir.
+ *
+ * Modo paralelo (nFranjas > 1), solo en rango flotante: la imagen se divide en franjas
+ * horizontales que se etiquetan a la vez, cada una con sus estadisticas locales. Despues se unen
+ * las regiones a ambos lados de cada costura y se renumeran en orden de semilla, con el mismo
+ * resultado que en serie (bench -p lo comprueba). En rango fijo el criterio depende del orden de
+ * barrido y nFranjas se ignora.
+ * Las franjas se reparten entre los hilos del planificador si se ha fijado uno y, si no,
+ * con cv::parallel_for_.
+ */
+
+using namespace cv;
+
+class UnionFind
+{
+public:
+    UnionFind() : planificador(NULL) {}
+
+    /** Etiqueta la imagen y rellena imgRegiones (-1 en bordes) y listRegiones. imgRegiones
+     * conserva su tipo de etiqueta si ya lo tenia (ver etiquetas.h); si no, sale en CV_32SC1.
+     * @param img imagen CV_8UC1 o CV_8UC3
+     * @param bordes mascara CV_8UC1, los pixeles a 255 no se etiquetan
+     * @param conectividad 4 u 8
+     * @param nFranjas numero de franjas etiquetadas en paralelo (1 = serie); solo en rango flotante
+     * @return false si las regiones no caben en el tipo de imgRegiones; hay que promoverla y repetir
+     */
+    bool etiquetar(const Mat &img, const Mat &bordes, int maxDif, bool rangoFlotante, int conectividad,
+                   Mat &imgRegiones, TablaRegiones &listRegiones, int nFranjas = 1);
+
+    //Hilos para las franjas (NULL = los de OpenCV); el planificador tiene que sobrevivir al etiquetado
+    void setPlanificador(PlanificadorTareas *p) { planificador = p; }
+
+    //Capacidad reservada por los buffers auxiliares, para el contador de EspacioTrabajo
+    size_t capacidad() const;
+
+private:
+    PlanificadorTareas *planificador;
+
+    //Regiones locales de una franja antes de unir las costuras
+    struct Franja{
+        int y0, y1;
+        std::vector<int> raices;        //indice de pixel de la raiz de cada region local
+        std::vector<int> nPuntos;
+        std::vector<int64> suma;
+        std::vector<int64> sumaCuadrados;
+        std::vector<Vec4i> limites;
+        std::vector<int> global;        //id final de cada region local
+        bool cabe;                      //Las regiones locales caben en el tipo de imgRegiones
+    };
+    std::vector<Franja> franjas;
+
+    std::vector<int> padre;         //-1 en bordes, raiz = menor indice de la componente
+    std::vector<uchar> minimo;      //Solo rango fijo: minimo por canal de cada raiz
+    std::vector<uchar> maximo;      //Solo rango fijo: maximo por canal de cada raiz
+    std::vector<int64> suma;        //Acumulado por canal de cada region
+    std::vector<int64> sumaCuadrados;
+    std::vector<Vec4i> limites;     //xMin, yMin, xMax, yMax de cada region
+
+    //cuerpo(0) .. cuerpo(n - 1) en paralelo
+    void paralelo(int n, const std::function<void(int)> &cuerpo);
+
+    inline int buscar(int i)
+    {
+        while (padre[i] != i)
+        {
+            padre[i] = padre[padre[i]];
+            i = padre[i];
+        }
+        return i;
+    }
+
+    //Nucleos especializados en canales, rango (fijo/flotante) y conectividad
+    template<int CN, bool FLOTANTE, int CONEX>
+    bool etiquetarT(const Mat &img, const Mat &bordes, int maxDif, Mat &imgRegiones,
+                    TablaRegiones &listRegiones, int nFranjas);
+    template<int CN, bool FLOTANTE, int CONEX> void primeraPasada(const Mat &img, const Mat &bordes, int maxDif, int y0, int y1);
+    template<int CN> bool fusionarSiCabe(const Mat &img, int raiz, int otra, int maxDif);
+    template<int CN, typename T> bool segundaPasada(const Mat &img, Mat &imgRegiones, TablaRegiones &listRegiones);
+
+    template<int CN, int CONEX, typename T>
+    bool etiquetarParalelo(const Mat &img, const Mat &bordes, int maxDif, Mat &imgRegiones,
+                           TablaRegiones &listRegiones, int nFranjas);
+    template<int CN, typename T> bool estadisticasFranja(const Mat &img, Mat &imgRegiones, Franja &f);
+    template<int CN, int CONEX> void unirCostura(const Mat &img, int y, int maxDif);
+    template<int CN> void unirPar(const Mat &img, int p, int q, int maxDif);
+    template<int CN, typename T> bool regionesGlobales(const Mat &img, Mat &imgRegiones, TablaRegiones &listRegiones);
+    void medias(int cn, TablaRegiones &listRegiones);
+};
+
+#endif // UNIONFIND_H
@@ -0,0 +1,40 @@
+#ifndef VECINDAD_H
+#define VECINDAD_H
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ * Vecindades 4 y 8 como constantes de compilacion, para que los nucleos plantillados en la
+ * conectividad recorran los vecinos con bucles de longitud fija que el compilador desenrolla.
+ * El orden de la 8-vecindad es el de la antigua lista de Segmentador::initVecinos (importa
+ * para los empates al asignar los bordes); la 4-vecindad es la misma lista sin las diagonales.
+ */
+
+//Desplazamiento (fila, columna) del vecino k de la 8-vecindad
+static const int vecindadFila[8]    = { -1, 0, +1, -1, +1, -1, 0, +1 };
+static const int vecindadColumna[8] = { -1, -1, -1, 0, 0, +1, +1, +1 };
+
+//Posiciones de la 4-vecindad dentro de la 8-vecindad
+static const int vecindad4[4] = { 1, 3, 4, 6 };
+
+template<int CONEX>
+inline int vecinoDeVecindad(int k)
+{
+    return CONEX == 8 ? k : vecindad4[k];
+}
+
+template<int CONEX>
+inline int desplazamientoFila(int k)
+{
+    return vecindadFila[vecinoDeVecindad<CONEX>(k)];
+}
+
+template<int CONEX>
+inline int desplazamientoColumna(int k)
+{
+    return vecindadColumna[vecinoDeVecindad<CONEX>(k)];
+}
+
+#endif // VECINDAD_H
@@ -0,0 +1,173 @@
+#include "video.h"
+#include "instrumentacion.h"
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ *
+ */
+
+ProcesadorVideo::ProcesadorVideo(int nBuffers, int nHilos) :
+    planificador(nHilos), ejecutor(planificador, nBuffers), ranuras(nBuffers), tabla(NULL)
+{
+    segmentador.setPlanificador(&planificador);
+}
+
+/** Abre entrada y salidas y espera a que el pipeline procese todos los frames
+ * @brief ProcesadorVideo::procesar
+ */
+bool ProcesadorVideo::procesar(const std::string &entrada, const std::string &salida, const std::string &tablaRegiones,
+                               const std::string &ficheroResultados, Size resolucion, int fourcc, Resumen &resumen)
+{
+    resumen = Resumen();
+    uint64_t inicio = Instrumentacion::ahoraNs();
+
+    //El primer frame se lee aqui para conocer el tamano antes de abrir la salida
+    if (!cap.open(entrada) || !cap.read(primero) || primero.empty())
+    {
+        cap.release();
+        return false;
+    }
+    tamano = resolucion.area() > 0 ? resolucion : primero.size();
+    double fps = cap.get(CAP_PROP_FPS);
+    if (!(fps > 0))
+        fps = 25;
+    if (!writer.open(salida, fourcc, fps, tamano, true))
+    {
+        cap.release();
+        return false;
+    }
+    if (!tablaRegiones.empty())
+    {
+        tabla = fopen(tablaRegiones.c_str(), "w");
+        if (tabla == NULL)
+        {
+            writer.release();
+            cap.release();
+            return false;
+        }
+        if (segmentador.getParametros().color)
+            fprintf(tabla, "frame,id,puntos,r,g,b,x,y,ancho,alto\n");
+        else
+            fprintf(tabla, "frame,id,puntos,gris,x,y,ancho,alto\n");
+    }
+    if (!ficheroResultados.empty() && !resultados.abrir(ficheroResultados))
+    {
+        if (tabla != NULL)
+            fclose(tabla);
+        tabla = NULL;
+        writer.release();
+        cap.release();
+        return false;
+    }
+    for (size_t i = 0; i < ranuras.size(); i++)
+    {
+        ranuras[i].color.create(tamano, CV_8UC3);
+        ranuras[i].gray.create(tamano, CV_8UC1);
+    }
+
+    ejecutor.iniciar([this](int r, uint64 n) { return decodificar(r, n); },
+                     [this](int r, uint64 n) { segmentar(r, n); },
+                     [this](int r, uint64 n) { codificar(r, n); });
+    ejecutor.esperar();
+
+    writer.release();
+    cap.release();
+    primero.release();
+    bool ok = true;
+    if (tabla != NULL)
+    {
+        ok = fclose(tabla) == 0;
+        tabla = NULL;
+    }
+    if (resultados.isOpened() && !resultados.cerrar())
+        ok = false;
+
+    EjecutorFrames::Resumen r;
+    ejecutor.resumen(r);
+    resumen.frames = r.frames;
+    resumen.segundos = (Instrumentacion::ahoraNs() - inicio) * 1e-9;
+    resumen.fps = resumen.segundos > 0 ? resumen.frames / resumen.segundos : 0;
+    resumen.msDecodificar = r.msEtapa[EjecutorFrames::ETAPA_CAPTURA];
+    resumen.msSegmentar = r.msEtapa[EjecutorFrames::ETAPA_SEGMENTACION];
+    resumen.msCodificar = r.msEtapa[EjecutorFrames::ETAPA_PRESENTACION];
+    resumen.latenciaMediaMs = r.latenciaMediaMs;
+    resumen.latenciaP99Ms = r.latenciaP99Ms;
+    return ok;
+}
+
+/** Etapa de captura: lee y convierte el siguiente frame del video
+ * @brief ProcesadorVideo::decodificar
+ * @return false al final del video
+ */
+bool ProcesadorVideo::decodificar(int ranura, uint64 numero)
+{
+    if (numero == 0)
+        bruto = primero;
+    else
+    {
+        Cronometro c(Instrumentacion::MED_CAPTURA);
+        if (!cap.read(bruto) || bruto.empty())
+            return false;
+    }
+    Ranura &e = ranuras[ranura];
+    Cronometro c(Instrumentacion::MED_CONVERSION);
+    cv::resize(bruto, e.color, tamano);
+    cvtColor(e.color, e.gray, COLOR_BGR2GRAY);
+    cvtColor(e.color, e.color, COLOR_BGR2RGB);
+    return true;
+}
+
+/** Etapa de segmentacion: el resultado se copia a la ranura para que la codificacion
+ * no dependa de los destinos del segmentador
+ * @brief ProcesadorVideo::segmentar
+ */
+void ProcesadorVideo::segmentar(int ranura, uint64 numero)
+{
+    Ranura &s = ranuras[ranura];
+    bool color = segmentador.getParametros().color;
+    segmentador.segmentation(s.color, s.gray, destColorImage, destGrayImage);
+    (color ? destColorImage : destGrayImage).copyTo(s.imagen);
+    s.regiones = segmentador.getListRegiones();
+    if (resultados.isOpened())
+    {
+        segmentador.getImgRegiones().copyTo(s.imgRegiones);
+        s.fronteras = segmentador.getFronteras();
+    }
+    s.numero = numero;
+}
+
+/** Etapa de presentacion: escribe el frame segmentado, su tabla de regiones y sus resultados
+ * @brief ProcesadorVideo::codificar
+ */
+void ProcesadorVideo::codificar(int ranura, uint64 numero)
+{
+    const Ranura &s = ranuras[ranura];
+    if (s.imagen.channels() == 3)
+        cvtColor(s.imagen, bgr, COLOR_RGB2BGR);
+    else
+        cvtColor(s.imagen, bgr, COLOR_GRAY2BGR);
+    writer.write(bgr);
+    if (tabla != NULL)
+        escribirRegiones(s);
+    if (resultados.isOpened())
+        resultados.escribir(s.imgRegiones, s.regiones, s.fronteras, segmentador.getParametros().color, s.numero);
+}
+
+void ProcesadorVideo::escribirRegiones(const Ranura &s)
+{
+    bool color = s.imagen.channels() == 3;
+    const TablaRegiones &r = s.regiones;
+    for (size_t k = 0; k < r.size(); k++)
+    {
+        fprintf(tabla, "%llu,%d,%d,", (unsigned long long)s.numero, (int)k, r.nPuntos[k]);
+        if (color)
+            fprintf(tabla, "%d,%d,%d,", r.rgbMedio[k][0], r.rgbMedio[k][1], r.rgbMedio[k][2]);
+        else
+            fprintf(tabla, "%d,", r.gMedio[k]);
+        const Rect &caja = r.caja[k];
+        fprintf(tabla, "%d,%d,%d,%d\n", caja.x, caja.y, caja.width, caja.height);
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef VIDEO_H
+#define VIDEO_H
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/videoio/videoio.hpp>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "ejecutor.h"
+#include "planificador.h"
+#include "region.h"
+#include "resultados.h"
+#include "segmentador.h"
+
+/**
+ * P4 - Image Segmentation
+ * Ivan González Domínguez
+ * Borja Alberto Tirado Galán
+ *
+ * Segmentacion de un fichero de video completo, sin descartar frames. Decodificacion,
+ * segmentacion y codificacion son las tres etapas de un EjecutorFrames, sobre los hilos de un
+ * PlanificadorTareas que tambien ejecutan las franjas de union-find. Los frames en vuelo
+ * estan acotados por el numero de buffers, asi que una etapa rapida espera a la lenta en vez
+ * de acumular frames. Ademas del video segmentado se escribe opcionalmente una tabla CSV con
+ * las regiones de cada frame y un fichero de resultados (ver resultados.h) con etiquetas,
+ * regiones y fronteras.
+ */
+
+using namespace cv;
+
+class ProcesadorVideo
+{
+public:
+    struct Resumen{
+        uint64 frames;
+        double segundos;        //De extremo a extremo, desde abrir la entrada hasta cerrar la salida
+        double fps;
+        double msDecodificar;   //Tiempo ocupado medio por frame de cada etapa, sin las esperas
+        double msSegmentar;
+        double msCodificar;
+        double latenciaMediaMs; //De empezar a decodificar un frame a terminar de escribirlo
+        double latenciaP99Ms;
+
+        Resumen() : frames(0), segundos(0), fps(0), msDecodificar(0), msSegmentar(0), msCodificar(0),
+            latenciaMediaMs(0), latenciaP99Ms(0) {}
+    };
+
+    /** @param nBuffers frames en vuelo
+     * @param nHilos hilos del planificador (0 = uno por nucleo)
+     */
+    explicit ProcesadorVideo(int nBuffers = 4, int nHilos = 0);
+
+    void setParametros(const Segmentador::Parametros &p) { segmentador.setParametros(p); }
+
+    /** Segmenta todos los frames de entrada y los escribe en salida
+     * @param tablaRegiones CSV con las regiones de cada frame ("" para no escribirlo)
+     * @param ficheroResultados resultados binarios de todos los frames ("" para no escribirlo)
+     * @param resolucion resolucion de trabajo y de salida; Size() para la del video
+     * @param fourcc codec de salida (VideoWriter::fourcc)
+     * @return false si no se ha podido abrir la entrada o alguna salida
+     */
+    bool procesar(const std::string &entrada, const std::string &salida, const std::string &tablaRegiones,
+                  const std::string &ficheroResultados, Size resolucion, int fourcc, Resumen &resumen);
+
+private:
+    //Buffers de un frame en vuelo, de la decodificacion a la codificacion
+    struct Ranura{
+        Mat color;                      //CV_8UC3, RGB
+        Mat gray;                       //CV_8UC1
+        Mat imagen;                     //destGrayImage o destColorImage
+        TablaRegiones regiones;
+        Mat imgRegiones;                //Solo con fichero de resultados
+        Fronteras fronteras;
+        uint64 numero;
+    };
+
+    PlanificadorTareas planificador;
+    EjecutorFrames ejecutor;
+    Segmentador segmentador;
+    std::vector<Ranura> ranuras;
+
+    VideoCapture cap;
+    VideoWriter writer;
+    FILE *tabla;
+    EscritorResultados resultados;
+    Size tamano;
+    Mat primero;                        //Primer frame, leido antes de arrancar para conocer el tamano
+    Mat bruto;                          //Frame leido, antes de redimensionar y convertir
+    Mat bgr;                            //Frame segmentado en BGR para el VideoWriter
+
+    //Los destinos son del segmentador y no rotan, porque el modo incremental parte del anterior
+    Mat destColorImage, destGrayImage;
+
+    bool decodificar(int ranura, uint64 numero);
+    void segmentar(int ranura, uint64 numero);
+    void codificar(int ranura, uint64 numero);
+    void escribirRegiones(const Ranura &s);
+};
+
+#endif // VIDEO_H